@@ -0,0 +1,182 @@
+#include "animation_clip.h"
+#include <algorithm>
+#include <cmath>
+
+// more forward steps than this from the cursor is a seek, a binary search is cheaper then
+constexpr uint32_t MaxCursorSteps = 4;
+
+// index of the last key at or before time
+static uint32_t search_key(const float *times, uint32_t count, float time)
+{
+  uint32_t key = std::upper_bound(times, times + count, time) - times;
+  return key > 0 ? key - 1 : 0;
+}
+
+// playback almost always moves forward by less than a key, so the cursor is stepped from the last frame's key,
+// time going back (loop, seek, reverse) or jumping far searches
+static uint32_t advance_key(const float *times, uint32_t count, float time, uint32_t &cursor)
+{
+  uint32_t key = cursor;
+  if (key >= count || time < times[key])
+    key = search_key(times, count, time);
+  else
+  {
+    for (uint32_t steps = 0; key + 1 < count && times[key + 1] <= time; steps++)
+    {
+      if (steps == MaxCursorSteps)
+      {
+        key = search_key(times, count, time);
+        break;
+      }
+      key++;
+    }
+  }
+  cursor = key;
+  return key;
+}
+
+// key and the blend factor towards the next one, cursor is nullptr for a plain search
+static uint32_t find_key(const float *times, uint32_t count, float time, uint32_t *cursor, float &t)
+{
+  uint32_t key = cursor ? advance_key(times, count, time, *cursor) : search_key(times, count, time);
+  if (key + 1 >= count)
+  {
+    t = 0.f;
+    return count - 1;
+  }
+  float span = times[key + 1] - times[key];
+  t = span > 0.f ? glm::clamp((time - times[key]) / span, 0.f, 1.f) : 0.f;
+  return key;
+}
+
+static vec3 sample_vec3(const std::vector<float> &times, const std::vector<vec3> &values, KeyRange range, float time,
+                        uint32_t *cursor = nullptr)
+{
+  float t;
+  uint32_t key = find_key(times.data() + range.first, range.count, time, cursor, t);
+  const vec3 *keys = values.data() + range.first;
+  return t > 0.f ? mix(keys[key], keys[key + 1], t) : keys[key];
+}
+
+static quat sample_quat(const std::vector<float> &times, const std::vector<quat> &values, KeyRange range, float time,
+                        uint32_t *cursor = nullptr)
+{
+  float t;
+  uint32_t key = find_key(times.data() + range.first, range.count, time, cursor, t);
+  const quat *keys = values.data() + range.first;
+  return t > 0.f ? slerp(keys[key], keys[key + 1], t) : keys[key];
+}
+
+static void sample_resampled_clip(const AnimationClip &clip, float time, Pose &pose)
+{
+  float frame = time * clip.sampleRate;
+  uint32_t first = std::min((uint32_t)frame, clip.frameCount - 1);
+  uint32_t second = std::min(first + 1, clip.frameCount - 1);
+  float t = frame - first;
+  const size_t trackCount = clip.tracks.size();
+  const JointKey *a = clip.frames.data() + first * trackCount;
+  const JointKey *b = clip.frames.data() + second * trackCount;
+  for (size_t i = 0; i < trackCount; i++)
+  {
+    uint32_t joint = clip.tracks[i].joint;
+    pose.translations[joint] = mix(a[i].translation, b[i].translation, t);
+    pose.rotations[joint] = normalize(a[i].rotation * (1.f - t) + b[i].rotation * t);
+    pose.scales[joint] = mix(a[i].scale, b[i].scale, t);
+  }
+}
+
+// cursors holds 3 keys per track or is empty for a plain search
+static void sample_clip(const AnimationClip &clip, float time, Pose &pose, uint32_t *cursors)
+{
+  time = glm::clamp(time, 0.f, clip.duration);
+  if (clip.sampleRate > 0)
+  {
+    sample_resampled_clip(clip, time, pose);
+    return;
+  }
+  for (size_t i = 0; i < clip.tracks.size(); i++)
+  {
+    const AnimationTrack &track = clip.tracks[i];
+    uint32_t *cursor = cursors ? cursors + i * 3 : nullptr;
+    if (track.translation.count)
+      pose.translations[track.joint] = sample_vec3(clip.translationTimes, clip.translations, track.translation, time, cursor);
+    if (track.rotation.count)
+      pose.rotations[track.joint] = sample_quat(clip.rotationTimes, clip.rotations, track.rotation, time, cursor ? cursor + 1 : nullptr);
+    if (track.scale.count)
+      pose.scales[track.joint] = sample_vec3(clip.scaleTimes, clip.scales, track.scale, time, cursor ? cursor + 2 : nullptr);
+  }
+}
+
+void sample_clip(const AnimationClip &clip, float time, Pose &pose)
+{
+  sample_clip(clip, time, pose, nullptr);
+}
+
+static size_t cursor_count(const AnimationClip *clip)
+{
+  return clip && clip->sampleRate == 0 ? clip->tracks.size() * 3 : 0;
+}
+
+void ClipPlayback::play(AnimationClipPtr new_clip, float start_time)
+{
+  clip = std::move(new_clip);
+  time = start_time;
+  cursors.assign(cursor_count(clip.get()), 0);
+}
+
+void ClipPlayback::advance(float dt)
+{
+  if (!clip)
+    return;
+  time += dt * speed;
+  if (loop && clip->duration > 0)
+  {
+    time = std::fmod(time, clip->duration);
+    if (time < 0)
+      time += clip->duration;
+  }
+  else
+    time = glm::clamp(time, 0.f, clip->duration);
+}
+
+void ClipPlayback::sample(Pose &pose)
+{
+  if (!clip)
+    return;
+  // the clip is shared, whoever else holds it may have changed its tracks since play
+  if (cursors.size() != cursor_count(clip.get()))
+    cursors.assign(cursor_count(clip.get()), 0);
+  sample_clip(*clip, time, pose, cursors.empty() ? nullptr : cursors.data());
+}
+
+AnimationClip resample_clip(const AnimationClip &clip, const Skeleton &skeleton, float sample_rate)
+{
+  AnimationClip result;
+  result.name = clip.name;
+  result.duration = clip.duration;
+  result.frameCount = std::max(1, (int)std::ceil(clip.duration * sample_rate - 1e-3f)) + 1;
+  result.sampleRate = clip.duration > 0 ? (result.frameCount - 1) / clip.duration : sample_rate;
+  for (const AnimationTrack &track : clip.tracks)
+    result.tracks.push_back(AnimationTrack{track.joint, {}, {}, {}});
+
+  const size_t trackCount = clip.tracks.size();
+  result.frames.resize(result.frameCount * trackCount);
+  for (uint32_t frame = 0; frame < result.frameCount; frame++)
+  {
+    float time = std::min(frame / result.sampleRate, clip.duration);
+    for (size_t i = 0; i < trackCount; i++)
+    {
+      const AnimationTrack &track = clip.tracks[i];
+      JointKey &key = result.frames[frame * trackCount + i];
+      key.translation = track.translation.count ?
+        sample_vec3(clip.translationTimes, clip.translations, track.translation, time) : skeleton.bindPose.translations[track.joint];
+      key.rotation = track.rotation.count ?
+        sample_quat(clip.rotationTimes, clip.rotations, track.rotation, time) : skeleton.bindPose.rotations[track.joint];
+      key.scale = track.scale.count ?
+        sample_vec3(clip.scaleTimes, clip.scales, track.scale, time) : skeleton.bindPose.scales[track.joint];
+      if (frame > 0 && dot(key.rotation, result.frames[(frame - 1) * trackCount + i].rotation) < 0.f)
+        key.rotation = -key.rotation;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "skeleton.h"
+
+// keys of one channel of one track, a range in the clip's arrays of that channel
+struct KeyRange
+{
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+// one animated joint, joints without a track keep whatever the pose had
+struct AnimationTrack
+{
+  uint32_t joint;
+  KeyRange translation, rotation, scale;
+};
+
+// all channels of a track at one frame of a resampled clip
+struct JointKey
+{
+  quat rotation;
+  vec3 translation;
+  vec3 scale;
+};
+
+// keys come in one of two layouts:
+// variable rate, packed per channel: times and values sit in their own arrays, a track's keys are one contiguous run in each;
+// resampled (sampleRate > 0), frame major: frames[frame * tracks.size() + track], so a sample reads two runs of JointKey
+// and finds them with integer math
+// tracks are sorted by joint in both
+struct AnimationClip
+{
+  std::string name;
+  float duration = 0; // seconds
+
+  std::vector<AnimationTrack> tracks; // key ranges are empty in resampled clips
+
+  float sampleRate = 0; // frames per second, exactly frameCount - 1 frames span the duration
+  uint32_t frameCount = 0;
+  std::vector<JointKey> frames;
+
+  std::vector<float> translationTimes; // seconds
+  std::vector<vec3> translations;
+  std::vector<float> rotationTimes;
+  std::vector<quat> rotations;
+  std::vector<float> scaleTimes;
+  std::vector<vec3> scales;
+};
+
+using AnimationClipPtr = std::shared_ptr<AnimationClip>;
+
+constexpr float DefaultResampleRate = 30.f;
+
+// fixed rate copy of a variable rate clip, channels without keys take the bind pose,
+// rotations are flipped to the hemisphere of the previous frame so frames can be blended with nlerp
+AnimationClip resample_clip(const AnimationClip &clip, const Skeleton &skeleton, float sample_rate = DefaultResampleRate);
+
+// writes the tracks' joints of pose, time is clamped to the clip
+// a binary search per channel for variable rate clips, ClipPlayback avoids it when time moves forward
+void sample_clip(const AnimationClip &clip, float time, Pose &pose);
+
+// one clip playing on one character, keeps the last key of every channel between frames
+// so sampling variable rate keys steps forward instead of searching, loops, seeks and reverse playback search
+class ClipPlayback
+{
+  AnimationClipPtr clip;
+  std::vector<uint32_t> cursors; // translation, rotation and scale key per track, unused for resampled clips
+
+public:
+  float time = 0; // seconds
+  float speed = 1; // negative plays backwards
+  bool loop = true;
+
+  const AnimationClipPtr &get_clip() const { return clip; }
+  void play(AnimationClipPtr new_clip, float start_time = 0);
+  void advance(float dt);
+  void sample(Pose &pose);
+};
@@ -0,0 +1,137 @@
+#include "animation_import.h"
+#include <algorithm>
+#include <assimp/scene.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <log.h>
+#include "cooked_animation.h"
+
+// assimp leaves it 0 when the file doesn't say, its own default is 25
+constexpr double DefaultTicksPerSecond = 25.0;
+
+template<typename Key, typename Value, typename Convert>
+static KeyRange import_keys(const Key *keys, unsigned count, double ticks_per_second, std::vector<float> &times,
+                            std::vector<Value> &values, Convert convert)
+{
+  KeyRange range{(uint32_t)times.size(), 0};
+  for (unsigned i = 0; i < count; i++)
+  {
+    float time = float(keys[i].mTime / ticks_per_second);
+    // assimp may repeat a time, only the last value counts
+    if (range.count > 0 && time <= times.back())
+    {
+      values.back() = convert(keys[i].mValue);
+      continue;
+    }
+    times.push_back(time);
+    values.push_back(convert(keys[i].mValue));
+    range.count++;
+  }
+  return range;
+}
+
+static vec3 from_assimp(const aiVector3D &v)
+{
+  return vec3(v.x, v.y, v.z);
+}
+
+static quat from_assimp(const aiQuaternion &q)
+{
+  return normalize(quat(q.w, q.x, q.y, q.z));
+}
+
+static AnimationClip import_animation(const aiAnimation *animation, const Skeleton &skeleton, const char *path)
+{
+  AnimationClip clip;
+  clip.name = animation->mName.C_Str();
+  const double ticksPerSecond = animation->mTicksPerSecond > 0 ? animation->mTicksPerSecond : DefaultTicksPerSecond;
+  clip.duration = float(animation->mDuration / ticksPerSecond);
+
+  std::vector<std::pair<int, const aiNodeAnim *>> channels;
+  for (unsigned i = 0; i < animation->mNumChannels; i++)
+  {
+    const aiNodeAnim *channel = animation->mChannels[i];
+    int joint = skeleton.find_joint(joint_name_hash(channel->mNodeName.C_Str()));
+    if (joint >= 0)
+      channels.emplace_back(joint, channel);
+    else
+      debug_log("%s: animation %s moves %s that isn't a joint", path, clip.name.c_str(), channel->mNodeName.C_Str());
+  }
+  std::sort(channels.begin(), channels.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  for (const auto &[joint, channel] : channels)
+  {
+    AnimationTrack track;
+    track.joint = joint;
+    track.translation = import_keys(channel->mPositionKeys, channel->mNumPositionKeys, ticksPerSecond,
+      clip.translationTimes, clip.translations, [](const aiVector3D &v) { return from_assimp(v); });
+    track.rotation = import_keys(channel->mRotationKeys, channel->mNumRotationKeys, ticksPerSecond,
+      clip.rotationTimes, clip.rotations, [](const aiQuaternion &q) { return from_assimp(q); });
+    track.scale = import_keys(channel->mScalingKeys, channel->mNumScalingKeys, ticksPerSecond,
+      clip.scaleTimes, clip.scales, [](const aiVector3D &v) { return from_assimp(v); });
+    clip.tracks.push_back(track);
+  }
+  return clip;
+}
+
+bool import_animations(const char *path, const Skeleton &skeleton, std::vector<AnimationClip> &clips)
+{
+  Assimp::Importer importer;
+  // same node names as the model import
+  importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);
+  importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, 1.f);
+
+  importer.ReadFile(path, aiProcess_GlobalScale);
+
+  const aiScene *scene = importer.GetScene();
+  if (!scene)
+  {
+    debug_error("no asset in %s", path);
+    return false;
+  }
+
+  clips.clear();
+  for (unsigned i = 0; i < scene->mNumAnimations; i++)
+    clips.push_back(import_animation(scene->mAnimations[i], skeleton, path));
+  return true;
+}
+
+std::vector<AnimationClipPtr> load_animations(const char *path, const Skeleton &skeleton, float resample_rate)
+{
+  std::vector<AnimationClip> clips;
+  std::vector<AnimationClipPtr> result;
+  if (!import_animations(path, skeleton, clips))
+    return result;
+  for (AnimationClip &clip : clips)
+  {
+    if (resample_rate > 0)
+      clip = resample_clip(clip, skeleton, resample_rate);
+    debug_log("%s: animation %s, %.2f s, %zu tracks", path, clip.name.c_str(), clip.duration, clip.tracks.size());
+    result.push_back(std::make_shared<AnimationClip>(std::move(clip)));
+  }
+  return result;
+}
+
+std::vector<CompressedClipPtr> load_compressed_animations(const char *path, const Skeleton &skeleton)
+{
+  std::vector<CompressedClip> clips;
+  std::string cookedPath = cooked_animation_path(path);
+  const uint64_t settings = animation_cook_settings(skeleton);
+  if (!open_cooked_animations(cookedPath.c_str(), path, settings, skeleton.size(), clips))
+  {
+    SourceStamp source;
+    std::vector<AnimationClip> imported;
+    if (!make_source_stamp(path, source) || !import_animations(path, skeleton, imported))
+      return {};
+    clips.clear();
+    for (const AnimationClip &clip : imported)
+      clips.push_back(compress_clip(clip, skeleton));
+    if (!save_cooked_animations(cookedPath.c_str(), source, settings, clips))
+      debug_error("can't cook %s", cookedPath.c_str());
+  }
+
+  std::vector<CompressedClipPtr> result;
+  for (CompressedClip &clip : clips)
+    result.push_back(std::make_shared<CompressedClip>(std::move(clip)));
+  return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <vector>
+#include "animation_clip.h"
+#include "clip_compression.h"
+
+// every animation of the file, tracks of nodes that aren't joints of skeleton are dropped
+bool import_animations(const char *path, const Skeleton &skeleton, std::vector<AnimationClip> &clips);
+
+// nullptr entries are never returned, an empty list means no animations or an error
+// resample_rate > 0 converts clips to fixed rate keys (see resample_clip), 0 keeps the source keys
+std::vector<AnimationClipPtr> load_animations(const char *path, const Skeleton &skeleton, float resample_rate = DefaultResampleRate);
+
+// quantized clips from <path>.anim, cooked on first load or when the source or the skeleton changed
+std::vector<CompressedClipPtr> load_compressed_animations(const char *path, const Skeleton &skeleton);
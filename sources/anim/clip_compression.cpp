@@ -0,0 +1,403 @@
+#include "clip_compression.h"
+#include <algorithm>
+#include <cmath>
+#include <log.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLIP_DECODE_SSE2 1
+#endif
+
+// below these a channel counts as constant, and a constant one as the bind pose
+constexpr float TranslationTolerance = 1e-4f; // model units
+constexpr float ScaleTolerance = 1e-4f;
+constexpr float RotationTolerance = 1e-7f; // 1 - |dot|, about 0.05 degrees
+
+constexpr uint32_t GroupSize = 4;
+constexpr uint32_t KeysPerGroup = 3 * GroupSize;
+constexpr float SmallestThreeRange = 0.70710678f; // components other than the largest are within +-1/sqrt(2)
+constexpr float RotationQuantum = 2.f * SmallestThreeRange / 32767.f;
+
+static uint32_t group_count(size_t channels)
+{
+  return (channels + GroupSize - 1) / GroupSize;
+}
+
+uint32_t compressed_frame_stride(uint32_t rotations, uint32_t translations, uint32_t scales)
+{
+  return KeysPerGroup * (group_count(rotations) + group_count(translations) + group_count(scales));
+}
+
+uint32_t CompressedClip::frame_stride() const
+{
+  return compressed_frame_stride(rotationJoints.size(), translationJoints.size(), scaleJoints.size());
+}
+
+size_t CompressedClip::memory_size() const
+{
+  return sizeof(CompressedClip) + keys.size() * sizeof(uint16_t) +
+    (translationRanges.size() + scaleRanges.size()) * sizeof(float) +
+    (rotationJoints.size() + translationJoints.size() + scaleJoints.size()) * sizeof(uint32_t) +
+    constants.size() * sizeof(ConstantKey);
+}
+
+static bool is_constant(const std::vector<vec3> &values, float tolerance)
+{
+  for (const vec3 &v : values)
+    if (any(greaterThan(abs(v - values[0]), vec3(tolerance))))
+      return false;
+  return true;
+}
+
+static bool is_constant(const std::vector<quat> &values)
+{
+  for (const quat &q : values)
+    if (1.f - std::abs(dot(q, values[0])) > RotationTolerance)
+      return false;
+  return true;
+}
+
+// largest component is dropped and made positive, its index goes to the top bits of a and b
+static void encode_rotation(quat q, uint16_t &a, uint16_t &b, uint16_t &c)
+{
+  q = normalize(q);
+  int largest = 0;
+  for (int i = 1; i < 4; i++)
+    if (std::abs(q[i]) > std::abs(q[largest]))
+      largest = i;
+  if (q[largest] < 0)
+    q = -q;
+  uint16_t values[3];
+  for (int i = 0, j = 0; i < 4; i++)
+  {
+    if (i == largest)
+      continue;
+    float v = glm::clamp(q[i], -SmallestThreeRange, SmallestThreeRange);
+    values[j++] = (uint16_t)std::lround((v + SmallestThreeRange) / RotationQuantum);
+  }
+  a = values[0] | ((largest >> 1) << 15);
+  b = values[1] | ((largest & 1) << 15);
+  c = values[2];
+}
+
+// min and extent per lane, padding lanes keep a zero range
+static void add_ranges(const std::vector<std::vector<vec3>> &channels, std::vector<float> &ranges)
+{
+  for (size_t group = 0; group < group_count(channels.size()); group++)
+  {
+    float range[6][GroupSize] = {};
+    for (uint32_t lane = 0; lane < GroupSize && group * GroupSize + lane < channels.size(); lane++)
+    {
+      const std::vector<vec3> &values = channels[group * GroupSize + lane];
+      vec3 lo = values[0], hi = values[0];
+      for (const vec3 &v : values)
+      {
+        lo = min(lo, v);
+        hi = max(hi, v);
+      }
+      for (int k = 0; k < 3; k++)
+      {
+        range[k][lane] = lo[k];
+        range[3 + k][lane] = hi[k] - lo[k];
+      }
+    }
+    ranges.insert(ranges.end(), &range[0][0], &range[0][0] + 6 * GroupSize);
+  }
+}
+
+static void add_vec3_keys(const std::vector<std::vector<vec3>> &channels, const float *ranges, uint32_t frame, uint16_t *keys)
+{
+  for (size_t group = 0; group < group_count(channels.size()); group++, ranges += 6 * GroupSize, keys += KeysPerGroup)
+  {
+    for (uint32_t lane = 0; lane < GroupSize && group * GroupSize + lane < channels.size(); lane++)
+    {
+      const vec3 &v = channels[group * GroupSize + lane][frame];
+      for (int k = 0; k < 3; k++)
+      {
+        float extent = ranges[(3 + k) * GroupSize + lane];
+        float t = extent > 0.f ? (v[k] - ranges[k * GroupSize + lane]) / extent : 0.f;
+        keys[k * GroupSize + lane] = (uint16_t)std::lround(glm::clamp(t, 0.f, 1.f) * 65535.f);
+      }
+    }
+  }
+}
+
+CompressedClip compress_clip(const AnimationClip &source_clip, const Skeleton &skeleton)
+{
+  AnimationClip resampled;
+  if (source_clip.sampleRate == 0)
+    resampled = resample_clip(source_clip, skeleton);
+  const AnimationClip &clip = source_clip.sampleRate > 0 ? source_clip : resampled;
+  CompressedClip result;
+  result.name = clip.name;
+  result.duration = clip.duration;
+  result.sampleRate = clip.sampleRate;
+  result.frameCount = clip.frameCount;
+
+  std::vector<std::vector<quat>> rotations;
+  std::vector<std::vector<vec3>> translations, scales;
+  const size_t trackCount = clip.tracks.size();
+  for (size_t i = 0; i < trackCount; i++)
+  {
+    const uint32_t joint = clip.tracks[i].joint;
+    std::vector<vec3> translation(clip.frameCount), scale(clip.frameCount);
+    std::vector<quat> rotation(clip.frameCount);
+    for (uint32_t frame = 0; frame < clip.frameCount; frame++)
+    {
+      const JointKey &key = clip.frames[frame * trackCount + i];
+      translation[frame] = key.translation;
+      scale[frame] = key.scale;
+      // continuous rotations keep the constant check and interpolation on the short arc
+      rotation[frame] = frame > 0 && dot(key.rotation, rotation[frame - 1]) < 0.f ? -key.rotation : key.rotation;
+    }
+
+    if (!is_constant(translation, TranslationTolerance))
+    {
+      result.translationJoints.push_back(joint);
+      translations.push_back(std::move(translation));
+    }
+    else if (any(greaterThan(abs(translation[0] - skeleton.bindPose.translations[joint]), vec3(TranslationTolerance))))
+      result.constants.push_back({joint, 0, vec4(translation[0], 0.f)});
+
+    if (!is_constant(rotation))
+    {
+      result.rotationJoints.push_back(joint);
+      rotations.push_back(std::move(rotation));
+    }
+    else if (1.f - std::abs(dot(rotation[0], skeleton.bindPose.rotations[joint])) > RotationTolerance)
+      result.constants.push_back({joint, 1, vec4(rotation[0].x, rotation[0].y, rotation[0].z, rotation[0].w)});
+
+    if (!is_constant(scale, ScaleTolerance))
+    {
+      result.scaleJoints.push_back(joint);
+      scales.push_back(std::move(scale));
+    }
+    else if (any(greaterThan(abs(scale[0] - skeleton.bindPose.scales[joint]), vec3(ScaleTolerance))))
+      result.constants.push_back({joint, 2, vec4(scale[0], 0.f)});
+  }
+
+  add_ranges(translations, result.translationRanges);
+  add_ranges(scales, result.scaleRanges);
+
+  const uint32_t stride = result.frame_stride();
+  const uint32_t rotationGroups = group_count(rotations.size());
+  const uint32_t translationGroups = group_count(translations.size());
+  result.keys.resize((size_t)stride * result.frameCount);
+  for (uint32_t frame = 0; frame < result.frameCount; frame++)
+  {
+    uint16_t *keys = result.keys.data() + (size_t)frame * stride;
+    for (uint32_t group = 0; group < rotationGroups; group++)
+    {
+      uint16_t *groupKeys = keys + group * KeysPerGroup;
+      for (uint32_t lane = 0; lane < GroupSize; lane++)
+      {
+        size_t channel = group * GroupSize + lane;
+        quat q = channel < rotations.size() ? rotations[channel][frame] : quat(1, 0, 0, 0);
+        encode_rotation(q, groupKeys[lane], groupKeys[GroupSize + lane], groupKeys[2 * GroupSize + lane]);
+      }
+    }
+    keys += rotationGroups * KeysPerGroup;
+    add_vec3_keys(translations, result.translationRanges.data(), frame, keys);
+    keys += translationGroups * KeysPerGroup;
+    add_vec3_keys(scales, result.scaleRanges.data(), frame, keys);
+  }
+
+  debug_log("animation %s: %u frames, %zu/%zu/%zu animated rotations/translations/scales, %zu constant channels, %zu -> %zu bytes",
+    clip.name.c_str(), clip.frameCount, rotations.size(), translations.size(), scales.size(), result.constants.size(),
+    clip.frames.size() * sizeof(JointKey), result.memory_size());
+  return result;
+}
+
+// the scalar decoder is the reference, it is always built so the simd one can be checked against it
+
+static quat decode_rotation(uint16_t a, uint16_t b, uint16_t c)
+{
+  int largest = ((a >> 15) << 1) | (b >> 15);
+  float values[3] = {
+    (a & 0x7fff) * RotationQuantum - SmallestThreeRange,
+    (b & 0x7fff) * RotationQuantum - SmallestThreeRange,
+    (c & 0x7fff) * RotationQuantum - SmallestThreeRange};
+  float w = std::sqrt(std::max(0.f, 1.f - values[0] * values[0] - values[1] * values[1] - values[2] * values[2]));
+  float q[4];
+  for (int i = 0, j = 0; i < 4; i++)
+    q[i] = i == largest ? w : values[j++];
+  return quat(q[3], q[0], q[1], q[2]);
+}
+
+static void sample_rotations_scalar(const CompressedClip &clip, const uint16_t *keys0, const uint16_t *keys1, float t, Pose &pose)
+{
+  for (size_t channel = 0; channel < clip.rotationJoints.size(); channel++)
+  {
+    size_t at = channel / GroupSize * KeysPerGroup + channel % GroupSize;
+    quat a = decode_rotation(keys0[at], keys0[at + GroupSize], keys0[at + 2 * GroupSize]);
+    quat b = decode_rotation(keys1[at], keys1[at + GroupSize], keys1[at + 2 * GroupSize]);
+    if (dot(a, b) < 0.f)
+      b = -b;
+    pose.rotations[clip.rotationJoints[channel]] = normalize(a * (1.f - t) + b * t);
+  }
+}
+
+static void sample_vec3s_scalar(const std::vector<uint32_t> &joints, const std::vector<float> &ranges, const uint16_t *keys0,
+                                const uint16_t *keys1, float t, std::vector<vec3> &pose)
+{
+  for (size_t channel = 0; channel < joints.size(); channel++)
+  {
+    size_t at = channel / GroupSize * KeysPerGroup + channel % GroupSize;
+    const float *groupRanges = ranges.data() + channel / GroupSize * 6 * GroupSize + channel % GroupSize;
+    vec3 v;
+    for (int k = 0; k < 3; k++)
+    {
+      float a = keys0[at + k * GroupSize] / 65535.f, b = keys1[at + k * GroupSize] / 65535.f;
+      v[k] = groupRanges[k * GroupSize] + (a + (b - a) * t) * groupRanges[(3 + k) * GroupSize];
+    }
+    pose[joints[channel]] = v;
+  }
+}
+
+#if CLIP_DECODE_SSE2
+
+static __m128i load_keys(const uint16_t *keys)
+{
+  return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(keys)), _mm_setzero_si128());
+}
+
+static __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 4 smallest three rotations to x, y, z, w lanes
+static void decode_rotations(const uint16_t *keys, __m128 q[4])
+{
+  const __m128i low = _mm_set1_epi32(0x7fff);
+  const __m128 quantum = _mm_set1_ps(RotationQuantum);
+  const __m128 offset = _mm_set1_ps(SmallestThreeRange);
+  __m128i ka = load_keys(keys), kb = load_keys(keys + GroupSize), kc = load_keys(keys + 2 * GroupSize);
+  __m128i largest = _mm_or_si128(_mm_slli_epi32(_mm_srli_epi32(ka, 15), 1), _mm_srli_epi32(kb, 15));
+  __m128 a = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(ka, low)), quantum), offset);
+  __m128 b = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(kb, low)), quantum), offset);
+  __m128 c = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(kc, low)), quantum), offset);
+  __m128 d = _mm_sub_ps(_mm_set1_ps(1.f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)), _mm_mul_ps(c, c)));
+  d = _mm_sqrt_ps(_mm_max_ps(d, _mm_setzero_ps()));
+
+  __m128 is0 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(0)));
+  __m128 is1 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(1)));
+  __m128 is2 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(2)));
+  __m128 is3 = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(3)));
+  // largest 0: d a b c, 1: a d b c, 2: a b d c, 3: a b c d
+  q[0] = select(is0, d, a);
+  q[1] = select(is0, a, select(is1, d, b));
+  q[2] = select(_mm_or_ps(is0, is1), b, select(is2, d, c));
+  q[3] = select(is3, d, c);
+}
+
+static void decode_vec3(const uint16_t *keys, const float *ranges, __m128 v[3])
+{
+  const __m128 scale = _mm_set1_ps(1.f / 65535.f);
+  for (int k = 0; k < 3; k++)
+  {
+    __m128 t = _mm_mul_ps(_mm_cvtepi32_ps(load_keys(keys + k * GroupSize)), scale);
+    __m128 lo = _mm_loadu_ps(ranges + k * GroupSize), extent = _mm_loadu_ps(ranges + (3 + k) * GroupSize);
+    v[k] = _mm_add_ps(lo, _mm_mul_ps(t, extent));
+  }
+}
+
+static void sample_rotations_sse2(const CompressedClip &clip, const uint16_t *keys0, const uint16_t *keys1, float t, Pose &pose)
+{
+  const __m128 vt = _mm_set1_ps(t);
+  const __m128 signBit = _mm_set1_ps(-0.f);
+  for (uint32_t group = 0; group < group_count(clip.rotationJoints.size()); group++)
+  {
+    __m128 a[4], b[4];
+    decode_rotations(keys0 + group * KeysPerGroup, a);
+    decode_rotations(keys1 + group * KeysPerGroup, b);
+    // the dropped component is always positive, so neighbouring frames may land in opposite hemispheres
+    __m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], b[0]), _mm_mul_ps(a[1], b[1])),
+      _mm_add_ps(_mm_mul_ps(a[2], b[2]), _mm_mul_ps(a[3], b[3])));
+    __m128 flip = _mm_and_ps(cosine, signBit);
+    __m128 q[4];
+    for (int k = 0; k < 4; k++)
+      q[k] = _mm_add_ps(a[k], _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(b[k], flip), a[k]), vt));
+    __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(q[0], q[0]), _mm_mul_ps(q[1], q[1])),
+      _mm_add_ps(_mm_mul_ps(q[2], q[2]), _mm_mul_ps(q[3], q[3]))));
+    alignas(16) float out[4][GroupSize];
+    for (int k = 0; k < 4; k++)
+      _mm_store_ps(out[k], _mm_div_ps(q[k], length));
+
+    for (uint32_t lane = 0; lane < GroupSize && group * GroupSize + lane < clip.rotationJoints.size(); lane++)
+      pose.rotations[clip.rotationJoints[group * GroupSize + lane]] = quat(out[3][lane], out[0][lane], out[1][lane], out[2][lane]);
+  }
+}
+
+static void sample_vec3s_sse2(const std::vector<uint32_t> &joints, const std::vector<float> &ranges, const uint16_t *keys0,
+                              const uint16_t *keys1, float t, std::vector<vec3> &pose)
+{
+  const __m128 vt = _mm_set1_ps(t);
+  for (uint32_t group = 0; group < group_count(joints.size()); group++)
+  {
+    __m128 a[3], b[3];
+    const float *groupRanges = ranges.data() + group * 6 * GroupSize;
+    decode_vec3(keys0 + group * KeysPerGroup, groupRanges, a);
+    decode_vec3(keys1 + group * KeysPerGroup, groupRanges, b);
+    alignas(16) float out[3][GroupSize];
+    for (int k = 0; k < 3; k++)
+      _mm_store_ps(out[k], _mm_add_ps(a[k], _mm_mul_ps(_mm_sub_ps(b[k], a[k]), vt)));
+
+    for (uint32_t lane = 0; lane < GroupSize && group * GroupSize + lane < joints.size(); lane++)
+      pose[joints[group * GroupSize + lane]] = vec3(out[0][lane], out[1][lane], out[2][lane]);
+  }
+}
+
+#endif
+
+static void sample_clip(const CompressedClip &clip, float time, Pose &pose, bool simd)
+{
+  if (clip.frameCount == 0)
+    return;
+  float frame = glm::clamp(time, 0.f, clip.duration) * clip.sampleRate;
+  uint32_t first = std::min((uint32_t)frame, clip.frameCount - 1);
+  uint32_t second = std::min(first + 1, clip.frameCount - 1);
+  float t = frame - first;
+
+  const uint32_t stride = clip.frame_stride();
+  const uint16_t *keys0 = clip.keys.data() + (size_t)first * stride;
+  const uint16_t *keys1 = clip.keys.data() + (size_t)second * stride;
+  const uint16_t *translationKeys0 = keys0 + group_count(clip.rotationJoints.size()) * KeysPerGroup;
+  const uint16_t *translationKeys1 = keys1 + group_count(clip.rotationJoints.size()) * KeysPerGroup;
+  const uint16_t *scaleKeys0 = translationKeys0 + group_count(clip.translationJoints.size()) * KeysPerGroup;
+  const uint16_t *scaleKeys1 = translationKeys1 + group_count(clip.translationJoints.size()) * KeysPerGroup;
+#if CLIP_DECODE_SSE2
+  if (simd)
+  {
+    sample_rotations_sse2(clip, keys0, keys1, t, pose);
+    sample_vec3s_sse2(clip.translationJoints, clip.translationRanges, translationKeys0, translationKeys1, t, pose.translations);
+    sample_vec3s_sse2(clip.scaleJoints, clip.scaleRanges, scaleKeys0, scaleKeys1, t, pose.scales);
+  }
+  else
+#endif
+  {
+    (void)simd;
+    sample_rotations_scalar(clip, keys0, keys1, t, pose);
+    sample_vec3s_scalar(clip.translationJoints, clip.translationRanges, translationKeys0, translationKeys1, t, pose.translations);
+    sample_vec3s_scalar(clip.scaleJoints, clip.scaleRanges, scaleKeys0, scaleKeys1, t, pose.scales);
+  }
+
+  for (const CompressedClip::ConstantKey &key : clip.constants)
+  {
+    if (key.channel == 0)
+      pose.translations[key.joint] = vec3(key.value);
+    else if (key.channel == 1)
+      pose.rotations[key.joint] = quat(key.value.w, key.value.x, key.value.y, key.value.z);
+    else
+      pose.scales[key.joint] = vec3(key.value);
+  }
+}
+
+void sample_clip(const CompressedClip &clip, float time, Pose &pose)
+{
+  sample_clip(clip, time, pose, true);
+}
+
+void sample_clip_scalar(const CompressedClip &clip, float time, Pose &pose)
+{
+  sample_clip(clip, time, pose, false);
+}
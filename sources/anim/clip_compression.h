@@ -0,0 +1,52 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include "animation_clip.h"
+
+// fixed rate clip with quantized keys, about 6 bytes per animated channel per frame instead of 12-16
+// rotations: smallest three, 2 bits for the dropped component and 15 bits for each other one (47 bits)
+// translations and scales: 16 bits per component inside the track's own min/max range
+// channels that never move are stored once, or dropped when they equal the bind pose
+struct CompressedClip
+{
+  std::string name;
+  float duration = 0; // seconds
+  float sampleRate = 0; // frames per second, frameCount - 1 frames span the duration
+  uint32_t frameCount = 0;
+
+  // joints of the animated channels, keys come in groups of 4 channels so they decode with simd
+  std::vector<uint32_t> rotationJoints;
+  std::vector<uint32_t> translationJoints;
+  std::vector<uint32_t> scaleJoints;
+  // per group of 4 channels: min x[4], y[4], z[4], then extent x[4], y[4], z[4]
+  std::vector<float> translationRanges;
+  std::vector<float> scaleRanges;
+  // frame major, per frame: rotation groups as a[4] b[4] c[4], then translation and scale groups as x[4] y[4] z[4]
+  std::vector<uint16_t> keys;
+
+  struct ConstantKey
+  {
+    uint32_t joint;
+    uint32_t channel; // 0 translation, 1 rotation (xyzw), 2 scale
+    vec4 value;
+  };
+  std::vector<ConstantKey> constants;
+
+  uint32_t frame_stride() const; // in uint16_t
+  size_t memory_size() const;
+};
+
+using CompressedClipPtr = std::shared_ptr<CompressedClip>;
+
+// uint16_t keys per frame for these numbers of animated channels
+uint32_t compressed_frame_stride(uint32_t rotations, uint32_t translations, uint32_t scales);
+
+// variable rate clips are resampled at DefaultResampleRate first
+CompressedClip compress_clip(const AnimationClip &clip, const Skeleton &skeleton);
+
+// channels stripped as bind pose aren't written, so pose has to start as the skeleton's bind pose
+void sample_clip(const CompressedClip &clip, float time, Pose &pose);
+
+// same result through the reference scalar decoder, sample_clip uses simd where the target has it
+void sample_clip_scalar(const CompressedClip &clip, float time, Pose &pose);
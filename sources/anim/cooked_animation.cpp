@@ -0,0 +1,156 @@
+#include "cooked_animation.h"
+#include <mapped_file.h>
+#include <log.h>
+
+std::string cooked_animation_path(const char *source_path)
+{
+  return std::string(source_path) + ".anim";
+}
+
+uint64_t animation_cook_settings(const Skeleton &skeleton)
+{
+  const float resampleRate = DefaultResampleRate;
+  uint64_t settings = hash_bytes(&resampleRate, sizeof(resampleRate));
+  settings = hash_bytes(skeleton.parents.data(), skeleton.parents.size() * sizeof(int), settings);
+  return hash_bytes(skeleton.nameHashes.data(), skeleton.nameHashes.size() * sizeof(uint32_t), settings);
+}
+
+// floats of min and extent, 6 per lane of every started group of 4
+static uint64_t range_count(uint32_t channels)
+{
+  return (channels + 3) / 4 * 24ull;
+}
+
+template<typename T>
+static std::span<const T> animation_channel(const MappedFile &file, const CookedAnimationHeader &header, CookedAnimationChannel c)
+{
+  const CookedBlob &blob = header.blobs[(int)c];
+  return std::span<const T>(reinterpret_cast<const T *>(file.data + blob.offset), blob.size / sizeof(T));
+}
+
+bool open_cooked_animations(const char *path, const char *source_path, uint64_t settings, uint32_t joint_count,
+                            std::vector<CompressedClip> &clips)
+{
+  MappedFilePtr file = map_file(path);
+  if (!file || file->size < sizeof(CookedAnimationHeader))
+    return false;
+
+  const auto *header = reinterpret_cast<const CookedAnimationHeader *>(file->data);
+  if (!is_cooked_header_valid(header->file, CookedAnimationMagic, CookedAnimationVersion, settings))
+    return false;
+
+  if (!is_source_unchanged(source_path, header->file.source))
+  {
+    debug_log("cooked animation %s is stale", path);
+    return false;
+  }
+
+  for (const CookedBlob &blob : header->blobs)
+  {
+    if (blob.offset % CookedBlobAlignment != 0 || blob.offset > file->size || blob.size > file->size - blob.offset)
+    {
+      debug_error("cooked animation %s is broken", path);
+      return false;
+    }
+  }
+
+  auto cookedClips = animation_channel<CookedClip>(*file, *header, CookedAnimationChannel::Clips);
+  auto joints = animation_channel<uint32_t>(*file, *header, CookedAnimationChannel::Joints);
+  auto ranges = animation_channel<float>(*file, *header, CookedAnimationChannel::Ranges);
+  auto keys = animation_channel<uint16_t>(*file, *header, CookedAnimationChannel::Keys);
+  auto constants = animation_channel<CompressedClip::ConstantKey>(*file, *header, CookedAnimationChannel::Constants);
+  auto strings = animation_channel<char>(*file, *header, CookedAnimationChannel::Strings);
+
+  bool valid = cookedClips.size() == header->file.count && (strings.empty() || strings.back() == '\0');
+  for (uint32_t joint : joints)
+    valid = valid && joint < joint_count;
+  for (const CompressedClip::ConstantKey &constant : constants)
+    valid = valid && constant.joint < joint_count && constant.channel < 3;
+
+  clips.clear();
+  for (size_t i = 0; i < cookedClips.size() && valid; i++)
+  {
+    const CookedClip &cooked = cookedClips[i];
+    const uint64_t jointCount = (uint64_t)cooked.rotationCount + cooked.translationCount + cooked.scaleCount;
+    const uint64_t translationRanges = range_count(cooked.translationCount), scaleRanges = range_count(cooked.scaleCount);
+    const uint64_t keyCount = (uint64_t)compressed_frame_stride(cooked.rotationCount, cooked.translationCount, cooked.scaleCount) *
+      cooked.frameCount;
+
+    valid = cooked.name < strings.size() && cooked.frameCount > 0 && cooked.sampleRate > 0 &&
+      cooked.firstJoint + jointCount <= joints.size() &&
+      cooked.firstRange + translationRanges + scaleRanges <= ranges.size() &&
+      cooked.firstKey + keyCount <= keys.size() &&
+      (uint64_t)cooked.firstConstant + cooked.constantCount <= constants.size();
+    if (!valid)
+      break;
+
+    CompressedClip clip;
+    clip.name = strings.data() + cooked.name;
+    clip.duration = cooked.duration;
+    clip.sampleRate = cooked.sampleRate;
+    clip.frameCount = cooked.frameCount;
+    const uint32_t *clipJoints = joints.data() + cooked.firstJoint;
+    clip.rotationJoints.assign(clipJoints, clipJoints + cooked.rotationCount);
+    clipJoints += cooked.rotationCount;
+    clip.translationJoints.assign(clipJoints, clipJoints + cooked.translationCount);
+    clipJoints += cooked.translationCount;
+    clip.scaleJoints.assign(clipJoints, clipJoints + cooked.scaleCount);
+    const float *clipRanges = ranges.data() + cooked.firstRange;
+    clip.translationRanges.assign(clipRanges, clipRanges + translationRanges);
+    clip.scaleRanges.assign(clipRanges + translationRanges, clipRanges + translationRanges + scaleRanges);
+    clip.keys.assign(keys.begin() + cooked.firstKey, keys.begin() + cooked.firstKey + keyCount);
+    clip.constants.assign(constants.begin() + cooked.firstConstant, constants.begin() + cooked.firstConstant + cooked.constantCount);
+    clips.push_back(std::move(clip));
+  }
+  if (!valid)
+  {
+    debug_error("cooked animation %s is broken", path);
+    clips.clear();
+    return false;
+  }
+  return true;
+}
+
+bool save_cooked_animations(const char *path, const SourceStamp &source, uint64_t settings, const std::vector<CompressedClip> &clips)
+{
+  CookedAnimationHeader header{};
+  header.file = {CookedAnimationMagic, CookedAnimationVersion, settings, (uint32_t)clips.size(), 0, source};
+
+  std::vector<CookedClip> cookedClips;
+  std::vector<uint32_t> joints;
+  std::vector<float> ranges;
+  std::vector<uint16_t> keys;
+  std::vector<CompressedClip::ConstantKey> constants;
+  std::vector<char> strings;
+  for (const CompressedClip &clip : clips)
+  {
+    CookedClip cooked{};
+    cooked.name = strings.size();
+    strings.insert(strings.end(), clip.name.c_str(), clip.name.c_str() + clip.name.size() + 1);
+    cooked.duration = clip.duration;
+    cooked.sampleRate = clip.sampleRate;
+    cooked.frameCount = clip.frameCount;
+    cooked.firstJoint = joints.size();
+    cooked.rotationCount = clip.rotationJoints.size();
+    cooked.translationCount = clip.translationJoints.size();
+    cooked.scaleCount = clip.scaleJoints.size();
+    joints.insert(joints.end(), clip.rotationJoints.begin(), clip.rotationJoints.end());
+    joints.insert(joints.end(), clip.translationJoints.begin(), clip.translationJoints.end());
+    joints.insert(joints.end(), clip.scaleJoints.begin(), clip.scaleJoints.end());
+    cooked.firstRange = ranges.size();
+    ranges.insert(ranges.end(), clip.translationRanges.begin(), clip.translationRanges.end());
+    ranges.insert(ranges.end(), clip.scaleRanges.begin(), clip.scaleRanges.end());
+    cooked.firstConstant = constants.size();
+    cooked.constantCount = clip.constants.size();
+    constants.insert(constants.end(), clip.constants.begin(), clip.constants.end());
+    cooked.firstKey = keys.size();
+    keys.insert(keys.end(), clip.keys.begin(), clip.keys.end());
+    cookedClips.push_back(cooked);
+  }
+
+  const std::span<const uint8_t> blobs[] = {
+    as_blob(cookedClips), as_blob(joints), as_blob(ranges), as_blob(keys), as_blob(constants), as_blob(strings)};
+  static_assert(std::size(blobs) == (size_t)CookedAnimationChannel::Count);
+
+  return write_cooked_file(path, &header, sizeof(header), header.blobs, blobs);
+}
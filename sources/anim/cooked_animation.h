@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <cooked_file.h>
+#include "clip_compression.h"
+
+enum class CookedAnimationChannel : uint32_t
+{
+  Clips,     // CookedClip
+  Joints,    // uint32_t, per clip rotation, translation then scale joints
+  Ranges,    // float, per clip translation then scale ranges
+  Keys,      // uint16_t
+  Constants, // CompressedClip::ConstantKey
+  Strings,   // zero terminated clip names
+  Count
+};
+
+// ranges into the shared channels, their sizes follow from the joint counts and frameCount
+struct CookedClip
+{
+  uint32_t name;
+  float duration;
+  float sampleRate;
+  uint32_t frameCount;
+  uint32_t firstJoint;
+  uint32_t rotationCount;
+  uint32_t translationCount;
+  uint32_t scaleCount;
+  uint32_t firstRange;
+  uint32_t firstConstant;
+  uint32_t constantCount;
+  uint32_t reserved;
+  uint64_t firstKey;
+};
+
+// file.count is the number of clips
+struct CookedAnimationHeader
+{
+  CookedFileHeader file;
+  CookedBlob blobs[(int)CookedAnimationChannel::Count];
+};
+
+constexpr uint32_t CookedAnimationMagic = 0x4d4e4143; // "CANM"
+constexpr uint32_t CookedAnimationVersion = 1;
+
+std::string cooked_animation_path(const char *source_path);
+
+// clips store joint indices, so they depend on the skeleton as much as on the source file
+uint64_t animation_cook_settings(const Skeleton &skeleton);
+
+// fills clips and returns true only when cooked file is intact and made from this source and settings
+bool open_cooked_animations(const char *path, const char *source_path, uint64_t settings, uint32_t joint_count,
+                            std::vector<CompressedClip> &clips);
+
+bool save_cooked_animations(const char *path, const SourceStamp &source, uint64_t settings, const std::vector<CompressedClip> &clips);
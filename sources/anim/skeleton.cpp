@@ -0,0 +1,88 @@
+#include "skeleton.h"
+#include <glm/gtx/matrix_decompose.hpp>
+#include <log.h>
+
+int Skeleton::find_joint(uint32_t name_hash) const
+{
+  for (size_t i = 0; i < nameHashes.size(); i++)
+    if (nameHashes[i] == name_hash)
+      return i;
+  return -1;
+}
+
+Skeleton make_skeleton(const ModelData &model)
+{
+  // a node is a joint when it is a bone or an ancestor of one, nodes are already sorted parents first
+  std::vector<bool> used(model.nodes.size(), false);
+  for (const ModelBone &bone : model.bones)
+    for (int node = bone.node; node >= 0 && !used[node]; node = model.nodes[node].parent)
+      used[node] = true;
+
+  Skeleton skeleton;
+  std::vector<int> nodeJoint(model.nodes.size(), -1);
+  for (size_t i = 0; i < model.nodes.size(); i++)
+  {
+    if (!used[i])
+      continue;
+    const ModelNode &node = model.nodes[i];
+    nodeJoint[i] = skeleton.size();
+    skeleton.parents.push_back(node.parent >= 0 ? nodeJoint[node.parent] : -1);
+    skeleton.names.push_back(node.name);
+    skeleton.nameHashes.push_back(joint_name_hash(node.name));
+    skeleton.inverseBindPoses.push_back(mat4(1.f));
+
+    vec3 translation, scale, skew;
+    quat rotation;
+    vec4 perspective;
+    glm::decompose(node.localTransform, scale, rotation, translation, skew, perspective);
+    skeleton.bindPose.translations.push_back(translation);
+    skeleton.bindPose.rotations.push_back(normalize(rotation));
+    skeleton.bindPose.scales.push_back(scale);
+  }
+
+  for (const ModelBone &bone : model.bones)
+  {
+    int joint = bone.node >= 0 ? nodeJoint[bone.node] : -1;
+    if (joint < 0)
+    {
+      // a bone without a node can't be animated, it stays at the root
+      debug_error("bone %s has no node", bone.name.c_str());
+      if (skeleton.size() == 0)
+      {
+        // no bone has a node, an identity root keeps skinJoints in range
+        skeleton.parents.push_back(-1);
+        skeleton.names.push_back("root");
+        skeleton.nameHashes.push_back(joint_name_hash("root"));
+        skeleton.inverseBindPoses.push_back(mat4(1.f));
+        skeleton.bindPose.translations.push_back(vec3(0.f));
+        skeleton.bindPose.rotations.push_back(quat(1.f, 0.f, 0.f, 0.f));
+        skeleton.bindPose.scales.push_back(vec3(1.f));
+      }
+      joint = 0;
+    }
+    else
+      skeleton.inverseBindPoses[joint] = bone.inverseBindPose;
+    skeleton.skinJoints.push_back(joint);
+  }
+  return skeleton;
+}
+
+void local_to_model(const Skeleton &skeleton, const Pose &local, std::span<mat4> model)
+{
+  for (size_t i = 0; i < skeleton.size(); i++)
+  {
+    mat4 transform = glm::translate(mat4(1.f), local.translations[i]) * glm::mat4_cast(local.rotations[i]) *
+      glm::scale(mat4(1.f), local.scales[i]);
+    int parent = skeleton.parents[i];
+    model[i] = parent >= 0 ? model[parent] * transform : transform;
+  }
+}
+
+void skinning_matrices(const Skeleton &skeleton, std::span<const mat4> model, std::span<mat4> skinning)
+{
+  for (size_t i = 0; i < skeleton.skinJoints.size(); i++)
+  {
+    uint32_t joint = skeleton.skinJoints[i];
+    skinning[i] = model[joint] * skeleton.inverseBindPoses[joint];
+  }
+}
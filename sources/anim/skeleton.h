@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <3dmath.h>
+#include <fnv.h>
+#include <render/model_data.h>
+
+// clips and gameplay code find joints by it instead of comparing strings
+constexpr uint32_t joint_name_hash(std::string_view name)
+{
+  return fnv1a32(name);
+}
+
+// local joint transforms, what clips sample into
+struct Pose
+{
+  std::vector<vec3> translations;
+  std::vector<quat> rotations;
+  std::vector<vec3> scales;
+
+  void resize(size_t joint_count)
+  {
+    translations.resize(joint_count);
+    rotations.resize(joint_count);
+    scales.resize(joint_count);
+  }
+};
+
+// the bones of a model and every node above them, one array per attribute
+// joints are sorted parents first, so local to model space is one pass from the front
+struct Skeleton
+{
+  std::vector<int> parents; // parents[i] < i, -1 for roots
+  std::vector<uint32_t> nameHashes;
+  std::vector<std::string> names;
+  std::vector<mat4> inverseBindPoses; // model space -> joint space, identity for joints that skin nothing
+  Pose bindPose;
+  // vertex bone indices (ModelData::bones) -> joints
+  std::vector<uint32_t> skinJoints;
+
+  size_t size() const { return parents.size(); }
+  // -1 when there is no such joint
+  int find_joint(uint32_t name_hash) const;
+};
+
+Skeleton make_skeleton(const ModelData &model);
+
+// model[i] = model[parents[i]] * local[i]
+void local_to_model(const Skeleton &skeleton, const Pose &local, std::span<mat4> model);
+
+// per vertex bone index, model space joint transforms times inverse bind poses
+void skinning_matrices(const Skeleton &skeleton, std::span<const mat4> model, std::span<mat4> skinning);
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cmath>
+#include <log.h>
+#include <anim/clip_compression.h>
+
+// checks of clip sampling on a synthetic skeleton, returns non zero when an error is over its limit:
+// round trip of the codec, compressed sampling against the resampled clip and the simd decoder against the scalar one,
+// covering animated, constant and bind pose channels of every kind and a partly filled last group,
+// then ClipPlayback cursors against a plain key search through forward, reverse, seek and fast playback
+
+constexpr int JointCount = 13;
+constexpr float Duration = 2.f;
+constexpr float TimeStep = 0.013f;
+
+// 16 bit keys inside the channel range (up to 2 units here) and 15 bit smallest three rotations
+constexpr float MaxTranslationError = 1e-4f;
+constexpr float MaxRotationError = 5e-4f; // radians
+constexpr float MaxScaleError = 1e-4f;
+constexpr float MaxDecoderDifference = 1e-5f;
+
+static Skeleton make_test_skeleton()
+{
+  Skeleton skeleton;
+  skeleton.parents.assign(JointCount, -1);
+  skeleton.bindPose.resize(JointCount);
+  for (int joint = 0; joint < JointCount; joint++)
+  {
+    skeleton.bindPose.translations[joint] = vec3(joint, 0, 0);
+    skeleton.bindPose.rotations[joint] = angleAxis(0.3f * joint, normalize(vec3(1, joint, 2)));
+    skeleton.bindPose.scales[joint] = vec3(1);
+  }
+  return skeleton;
+}
+
+// variable rate keys, every third translation and fourth rotation stays in the bind pose,
+// rotations flip hemisphere every other key like some exporters do
+static AnimationClip make_test_clip(const Skeleton &skeleton)
+{
+  constexpr uint32_t KeyCount = 40;
+  AnimationClip clip;
+  clip.name = "check";
+  clip.duration = Duration;
+  for (uint32_t joint = 0; joint < JointCount; joint++)
+  {
+    AnimationTrack track{joint, {}, {}, {}};
+    track.translation = {(uint32_t)clip.translationTimes.size(), KeyCount};
+    track.rotation = {(uint32_t)clip.rotationTimes.size(), KeyCount};
+    track.scale = {(uint32_t)clip.scaleTimes.size(), KeyCount};
+    for (uint32_t key = 0; key < KeyCount; key++)
+    {
+      float time = Duration * key / (KeyCount - 1);
+      clip.translationTimes.push_back(time);
+      clip.rotationTimes.push_back(time);
+      clip.scaleTimes.push_back(time);
+
+      if (joint % 3 == 0)
+        clip.translations.push_back(skeleton.bindPose.translations[joint]);
+      else if (joint % 3 == 1)
+        clip.translations.push_back(vec3(5, 1, 1));
+      else
+        clip.translations.push_back(vec3(std::sin(time * 3 + joint), time, -0.1f * time));
+
+      quat rotation = joint % 4 == 0 ? skeleton.bindPose.rotations[joint] : angleAxis(2.5f * time + joint, normalize(vec3(1, 2, joint)));
+      clip.rotations.push_back(key % 2 ? -rotation : rotation);
+
+      clip.scales.push_back(joint == 5 ? vec3(1 + time) : vec3(1));
+    }
+    clip.tracks.push_back(track);
+  }
+  return clip;
+}
+
+// about the angle between them for small errors, acos of the dot product is all float noise there
+static float rotation_error(quat a, quat b)
+{
+  if (dot(a, b) < 0.f)
+    b = -b;
+  return 2.f * length(vec4(a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w));
+}
+
+struct PoseError
+{
+  float translation = 0;
+  float rotation = 0;
+  float scale = 0;
+
+  void add(const Pose &a, const Pose &b)
+  {
+    for (int joint = 0; joint < JointCount; joint++)
+    {
+      translation = std::max(translation, length(a.translations[joint] - b.translations[joint]));
+      rotation = std::max(rotation, rotation_error(a.rotations[joint], b.rotations[joint]));
+      scale = std::max(scale, length(a.scales[joint] - b.scales[joint]));
+    }
+  }
+};
+
+// same variable rate clip, but played through ClipPlayback cursors and sampled by a plain search each frame
+static PoseError check_playback(const Skeleton &skeleton, const AnimationClip &clip)
+{
+  constexpr int FrameCount = 1000;
+  constexpr float FrameTime = 1.f / 60.f;
+  auto shared = std::make_shared<AnimationClip>(clip);
+  ClipPlayback playback;
+  playback.play(shared);
+  PoseError error;
+  for (int frame = 0; frame < FrameCount; frame++)
+  {
+    if (frame == 500)
+      playback.speed = -1;
+    if (frame == 700)
+      playback.time = 1.3f;
+    if (frame == 800)
+      playback.speed = 3;
+    playback.advance(FrameTime);
+    Pose cursors = skeleton.bindPose, search = skeleton.bindPose;
+    playback.sample(cursors);
+    sample_clip(clip, playback.time, search);
+    error.add(cursors, search);
+  }
+  return error;
+}
+
+static bool check(bool ok, const char *what)
+{
+  if (!ok)
+    debug_error("%s", what);
+  return ok;
+}
+
+int main()
+{
+  const Skeleton skeleton = make_test_skeleton();
+  const AnimationClip source = make_test_clip(skeleton);
+  const AnimationClip resampled = resample_clip(source, skeleton);
+  const CompressedClip compressed = compress_clip(resampled, skeleton);
+
+  PoseError codecError, decoderDifference;
+  for (float time = 0; time <= Duration; time += TimeStep)
+  {
+    Pose reference = skeleton.bindPose, simd = skeleton.bindPose, scalar = skeleton.bindPose;
+    sample_clip(resampled, time, reference);
+    sample_clip(compressed, time, simd);
+    sample_clip_scalar(compressed, time, scalar);
+    codecError.add(reference, simd);
+    decoderDifference.add(simd, scalar);
+  }
+
+  debug_log("max error translation %g, rotation %g rad, scale %g", codecError.translation, codecError.rotation, codecError.scale);
+  debug_log("max simd and scalar difference translation %g, rotation %g rad, scale %g",
+    decoderDifference.translation, decoderDifference.rotation, decoderDifference.scale);
+  const PoseError playbackDifference = check_playback(skeleton, source);
+  debug_log("max cursor and search difference translation %g, rotation %g rad, scale %g",
+    playbackDifference.translation, playbackDifference.rotation, playbackDifference.scale);
+
+  bool ok = true;
+  ok &= check(codecError.translation <= MaxTranslationError, "translation error over the limit");
+  ok &= check(codecError.rotation <= MaxRotationError, "rotation error over the limit");
+  ok &= check(codecError.scale <= MaxScaleError, "scale error over the limit");
+  ok &= check(decoderDifference.translation <= MaxDecoderDifference && decoderDifference.rotation <= MaxDecoderDifference &&
+    decoderDifference.scale <= MaxDecoderDifference, "simd and scalar decoders disagree");
+  // both find the same keys, so they agree exactly
+  ok &= check(playbackDifference.translation == 0 && playbackDifference.rotation == 0 && playbackDifference.scale == 0,
+    "cursor playback differs from a plain search");
+  return ok ? 0 : 1;
+}
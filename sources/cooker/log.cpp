@@ -0,0 +1,33 @@
+#include <log.h>
+#include <stdarg.h>
+#include <mutex>
+
+// headless replacement of engine/log.cpp, workers log from many threads
+static std::mutex m;
+
+static void debug_common(const char *fmt, int status, va_list args)
+{
+  char messageBuf[1024];
+  vsnprintf(messageBuf, sizeof(messageBuf), fmt, args);
+  std::unique_lock write_lock(m);
+  if (!status)
+    fprintf(stderr, "\033[31m%s\033[39m\n", messageBuf);
+  else
+    fprintf(stdout, "%s\n", messageBuf);
+}
+
+void debug_error(const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  debug_common(fmt, 0, args);
+  va_end(args);
+}
+
+void debug_log(const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  debug_common(fmt, 1, args);
+  va_end(args);
+}
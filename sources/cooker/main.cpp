@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <log.h>
+#include <cooked_file.h>
+#include <render/cooked_mesh.h>
+#include <render/cooked_model.h>
+#include <render/cooked_texture.h>
+#include <render/mesh_import.h>
+#include <render/texture_import.h>
+#include <render/texture_compressor.h>
+#include <anim/animation_import.h>
+#include <anim/cooked_animation.h>
+
+namespace fs = std::filesystem;
+
+struct CookedOutput
+{
+  std::string path;
+  uint32_t magic;
+  uint32_t version;
+};
+
+struct AssetKind
+{
+  const char *name;
+  std::vector<std::string> extensions;
+  uint64_t (*settings)(const char *source_path);
+  // outputs(source, 1)[0] is read first, its header tells the count of the rest
+  std::vector<CookedOutput> (*outputs)(const char *source_path, uint32_t count);
+  bool (*cook)(const char *source_path);
+  // kinds of a later pass start once every job of the earlier passes is done, so they can read what those cooked
+  int pass = 0;
+};
+
+static bool compactVertices = true;
+static TextureCompression textureCompression = TextureCompression::Auto;
+
+// animations store joint indices, the skeleton comes from the model cooked in the pass before
+// from the same file, a source is never imported twice for it
+static bool read_skeleton(const char *source_path, Skeleton &skeleton)
+{
+  ModelData model;
+  int meshCount = 0;
+  std::string cookedPath = cooked_model_path(source_path);
+  if (!open_cooked_model(cookedPath.c_str(), source_path, mesh_cook_settings(compactVertices), model, meshCount))
+    return false;
+  skeleton = make_skeleton(model);
+  return true;
+}
+
+static bool cook_animations(const char *source_path)
+{
+  Skeleton skeleton;
+  SourceStamp source;
+  std::vector<AnimationClip> imported;
+  if (!read_skeleton(source_path, skeleton) || !make_source_stamp(source_path, source) ||
+      !import_animations(source_path, skeleton, imported))
+    return false;
+  std::vector<CompressedClip> clips;
+  for (const AnimationClip &clip : imported)
+    clips.push_back(compress_clip(clip, skeleton));
+  return save_cooked_animations(cooked_animation_path(source_path).c_str(), source, animation_cook_settings(skeleton), clips);
+}
+
+static const AssetKind assetKinds[] = {
+  {
+    "model", {".fbx"},
+    [](const char *) { return mesh_cook_settings(compactVertices); },
+    [](const char *source_path, uint32_t count)
+    {
+      std::vector<CookedOutput> outputs = {{cooked_model_path(source_path), CookedModelMagic, CookedModelVersion}};
+      for (uint32_t i = 0; i < count; i++)
+        outputs.push_back({cooked_mesh_path(source_path, i), CookedMeshMagic, CookedMeshVersion});
+      return outputs;
+    },
+    [](const char *source_path)
+    {
+      std::vector<MeshData> meshes;
+      ModelData model;
+      return cook_model(source_path, compactVertices, meshes, model);
+    }
+  },
+  {
+    "texture", {".jpg", ".jpeg", ".png", ".tga", ".bmp"},
+    [](const char *) { return texture_cook_settings(textureCompression); },
+    [](const char *source_path, uint32_t) { return std::vector<CookedOutput>{{cooked_texture_path(source_path), CookedTextureMagic, CookedTextureVersion}}; },
+    [](const char *source_path) { return cook_texture(source_path, textureCompression); }
+  },
+  {
+    "animation", {".fbx"},
+    [](const char *source_path)
+    {
+      // without a cooked model (its cook failed) the settings match no cooked file, the cook fails on it again
+      Skeleton skeleton;
+      return read_skeleton(source_path, skeleton) ? animation_cook_settings(skeleton) : ~uint64_t(0);
+    },
+    [](const char *source_path, uint32_t) { return std::vector<CookedOutput>{{cooked_animation_path(source_path), CookedAnimationMagic, CookedAnimationVersion}}; },
+    cook_animations,
+    1
+  },
+};
+
+struct CookJob
+{
+  std::string path;
+  const AssetKind *kind;
+};
+
+enum class CookState
+{
+  UpToDate,
+  Touched, // same content and settings, only the stamp is outdated
+  Dirty
+};
+
+static bool read_cooked_header(const std::string &path, CookedFileHeader &header)
+{
+  std::ifstream file(path, std::ios::binary);
+  return file && file.read(reinterpret_cast<char *>(&header), sizeof(header));
+}
+
+static CookState check_outputs(const CookJob &job, std::vector<std::string> &outputs, SourceStamp &current)
+{
+  const AssetKind &kind = *job.kind;
+  const uint64_t settings = kind.settings(job.path.c_str());
+  CookedFileHeader first;
+  CookedOutput firstOutput = kind.outputs(job.path.c_str(), 1)[0];
+  if (!read_cooked_header(firstOutput.path, first) ||
+      !is_cooked_header_valid(first, firstOutput.magic, firstOutput.version, settings))
+    return CookState::Dirty;
+
+  // every output of a source must come from the same cook
+  for (const CookedOutput &output : kind.outputs(job.path.c_str(), first.count))
+  {
+    CookedFileHeader header;
+    outputs.push_back(output.path);
+    if (!read_cooked_header(output.path, header) || !is_cooked_header_valid(header, output.magic, output.version, settings) ||
+        header.count != first.count || memcmp(&header.source, &first.source, sizeof(SourceStamp)) != 0)
+      return CookState::Dirty;
+  }
+
+  // hashing is only needed when the stamp moved
+  std::error_code ec;
+  if (fs::file_size(job.path, ec) == first.source.size && !ec &&
+      fs::last_write_time(job.path, ec).time_since_epoch().count() == first.source.time && !ec)
+    return CookState::UpToDate;
+
+  if (!make_source_stamp(job.path.c_str(), current))
+    return CookState::Dirty;
+  if (current.size != first.source.size || current.hash != first.source.hash)
+    return CookState::Dirty;
+  return CookState::Touched;
+}
+
+static std::vector<CookJob> collect_jobs(const fs::path &root)
+{
+  std::vector<CookJob> jobs;
+  for (const fs::directory_entry &entry : fs::recursive_directory_iterator(root))
+  {
+    if (!entry.is_regular_file())
+      continue;
+    std::string extension = entry.path().extension().string();
+    for (char &c : extension)
+      c = tolower(c);
+    for (const AssetKind &kind : assetKinds)
+      for (const std::string &e : kind.extensions)
+        if (e == extension)
+          jobs.push_back(CookJob{entry.path().string(), &kind});
+  }
+  return jobs;
+}
+
+int main(int argc, char **argv)
+{
+  fs::path root = "resources";
+  unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+  bool force = false;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-j") && i + 1 < argc)
+      threadCount = std::max(1, atoi(argv[++i]));
+    else if (!strcmp(argv[i], "--force"))
+      force = true;
+    else if (!strcmp(argv[i], "--full-vertices"))
+      compactVertices = false;
+    else if (!strcmp(argv[i], "--bc7"))
+      textureCompression = TextureCompression::BC7;
+    else if (!strcmp(argv[i], "--uncompressed"))
+      textureCompression = TextureCompression::None;
+    else if (argv[i][0] != '-')
+      root = argv[i];
+    else
+    {
+      debug_error("usage: asset_cooker [resources dir] [-j threads] [--force] [--full-vertices] [--bc7 | --uncompressed]");
+      return 1;
+    }
+  }
+  if (!fs::is_directory(root))
+  {
+    debug_error("%s isn't a directory", root.string().c_str());
+    return 1;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<CookJob> jobs = collect_jobs(root);
+  std::stable_sort(jobs.begin(), jobs.end(), [](const CookJob &a, const CookJob &b) { return a.kind->pass < b.kind->pass; });
+  std::atomic<size_t> nextJob = 0;
+  size_t passEnd = 0;
+  std::atomic<int> cooked = 0, skipped = 0, failed = 0;
+
+  auto worker = [&]()
+  {
+    for (size_t i = nextJob++; i < passEnd; i = nextJob++)
+    {
+      const CookJob &job = jobs[i];
+      std::vector<std::string> outputs;
+      SourceStamp current;
+      CookState state = force ? CookState::Dirty : check_outputs(job, outputs, current);
+      if (state == CookState::Touched)
+      {
+        for (const std::string &output : outputs)
+          if (!restamp_cooked_file(output.c_str(), current))
+            state = CookState::Dirty;
+      }
+      if (state != CookState::Dirty)
+      {
+        skipped++;
+        continue;
+      }
+      if (job.kind->cook(job.path.c_str()))
+      {
+        debug_log("cooked %s %s", job.kind->name, job.path.c_str());
+        cooked++;
+      }
+      else
+      {
+        debug_error("failed to cook %s", job.path.c_str());
+        failed++;
+      }
+    }
+  };
+
+  threadCount = std::min<unsigned>(threadCount, std::max<size_t>(1, jobs.size()));
+  for (size_t passBegin = 0; passBegin < jobs.size(); passBegin = passEnd)
+  {
+    passEnd = passBegin;
+    while (passEnd < jobs.size() && jobs[passEnd].kind->pass == jobs[passBegin].kind->pass)
+      passEnd++;
+    nextJob = passBegin;
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; i++)
+      threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+      thread.join();
+  }
+
+  std::chrono::duration<float> d = std::chrono::high_resolution_clock::now() - start;
+  debug_log("%d cooked, %d up to date, %d failed in %.2fs on %u threads",
+    cooked.load(), skipped.load(), failed.load(), d.count(), threadCount);
+  return failed ? 1 : 0;
+}
@@ -1,4 +1,7 @@
 #include "application.h"
+#include "task_queue.h"
+#include "resource_cache.h"
+#include "file_watcher.h"
 #include <glad/glad.h>
 #include <imgui/imgui_impl_opengl3.h>
 #include <imgui/imgui_impl_sdl.h>
@@ -7,8 +10,13 @@
 extern void game_init();
 extern void game_update();
 extern void game_render();
+extern void game_shutdown();
+extern void release_geometry_arenas();
+extern void release_material_buffer();
 extern void start_time();
 extern void update_time();
+extern void update_texture_streaming();
+extern void process_texture_uploads();
 
 typedef void *SDL_GLContext;
 
@@ -20,6 +28,8 @@ struct SDLContext
 
 SDLContext context;
 
+constexpr float MainThreadJobBudgetMs = 2.f;
+
 void init_application(const char *project_name, int width, int height, bool full_screen)
 {
   SDL_Init(SDL_INIT_EVERYTHING);
@@ -53,6 +63,13 @@ void init_application(const char *project_name, int width, int height, bool full
 
 void close_application()
 {
+  stop_file_watcher();
+  stop_workers();
+  // gpu resources go while the context is alive, static destruction order across files is unspecified
+  game_shutdown();
+  release_geometry_arenas();
+  release_material_buffer();
+  log_resource_cache_stats();
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplSDL2_Shutdown();
   ImGui::DestroyContext();
@@ -100,6 +117,10 @@ void main_loop()
   while (running)
   {
     update_time();
+    // finished background loads are uploaded here, a few per frame
+    process_main_thread_jobs(MainThreadJobBudgetMs);
+    update_texture_streaming();
+    process_texture_uploads();
 
 		running = sdl_event_handler();
 
@@ -132,4 +153,11 @@ float get_aspect_ratio()
   int width, height;
   SDL_GL_GetDrawableSize(context.window, &width, &height);
   return (float)width / height;
+}
+
+int get_screen_height()
+{
+  int width, height;
+  SDL_GL_GetDrawableSize(context.window, &width, &height);
+  return height;
 }
\ No newline at end of file
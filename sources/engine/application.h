@@ -4,6 +4,8 @@
 
 float get_aspect_ratio();
 
+int get_screen_height();
+
 float get_time();
 
 float get_delta_time();
\ No newline at end of file
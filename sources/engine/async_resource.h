@@ -0,0 +1,29 @@
+#pragma once
+#include <memory>
+
+// handle of a resource that is loaded in the background
+// only the main thread reads or resolves it, workers hand results over with run_on_main_thread
+template<typename T>
+class AsyncResource
+{
+  std::shared_ptr<T> placeholder;
+  std::shared_ptr<T> resource;
+  bool done = false;
+
+public:
+  AsyncResource(std::shared_ptr<T> placeholder) : placeholder(std::move(placeholder)) {}
+
+  // the loaded resource, the placeholder while loading or when loading failed
+  const std::shared_ptr<T> &get() const { return resource ? resource : placeholder; }
+  bool is_ready() const { return resource != nullptr; }
+  bool is_failed() const { return done && !resource; }
+
+  void resolve(std::shared_ptr<T> loaded)
+  {
+    resource = std::move(loaded);
+    done = true;
+  }
+};
+
+template<typename T>
+using AsyncResourcePtr = std::shared_ptr<AsyncResource<T>>;
@@ -0,0 +1,108 @@
+#include "cooked_file.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed)
+{
+  // fnv-1a over 8 byte words, tail is hashed by bytes
+  constexpr uint64_t prime = 0x100000001b3ull;
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  uint64_t hash = seed;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8)
+  {
+    uint64_t word;
+    memcpy(&word, bytes + i, 8);
+    hash = (hash ^ word) * prime;
+    hash ^= hash >> 29;
+  }
+  for (; i < size; i++)
+    hash = (hash ^ bytes[i]) * prime;
+  return hash;
+}
+
+static bool read_file_time(const char *path, uint64_t &size, int64_t &time)
+{
+  std::error_code ec;
+  size = std::filesystem::file_size(path, ec);
+  if (ec)
+    return false;
+  time = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+  return !ec;
+}
+
+static uint64_t hash_file(const char *path)
+{
+  MappedFilePtr file = map_file(path);
+  return file ? hash_bytes(file->data, file->size) : hash_bytes(nullptr, 0);
+}
+
+bool make_source_stamp(const char *source_path, SourceStamp &stamp)
+{
+  if (!read_file_time(source_path, stamp.size, stamp.time))
+    return false;
+  stamp.hash = hash_file(source_path);
+  return true;
+}
+
+bool is_source_unchanged(const char *source_path, const SourceStamp &stamp)
+{
+  uint64_t size;
+  int64_t time;
+  if (!read_file_time(source_path, size, time))
+    return true;
+  if (size != stamp.size)
+    return false;
+  return time == stamp.time || hash_file(source_path) == stamp.hash;
+}
+
+bool is_cooked_header_valid(const CookedFileHeader &header, uint32_t magic, uint32_t version, uint64_t settings)
+{
+  return header.magic == magic && header.version == version && header.settings == settings;
+}
+
+bool write_cooked_file(const char *path, void *header, size_t header_size,
+  std::span<CookedBlob> blob_table, std::span<const std::span<const uint8_t>> blobs)
+{
+  uint64_t offset = header_size;
+  for (size_t i = 0; i < blobs.size(); i++)
+  {
+    offset = (offset + CookedBlobAlignment - 1) & ~(CookedBlobAlignment - 1);
+    blob_table[i] = {offset, blobs[i].size()};
+    offset += blobs[i].size();
+  }
+
+  // several threads may cook the same source at once, each writes its own temporary file
+  std::string tmpPath = std::string(path) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return false;
+    file.write(static_cast<const char *>(header), header_size);
+    for (size_t i = 0; i < blobs.size(); i++)
+    {
+      static const char zeros[CookedBlobAlignment] = {};
+      file.write(zeros, blob_table[i].offset - (uint64_t)file.tellp());
+      file.write(reinterpret_cast<const char *>(blobs[i].data()), blobs[i].size());
+    }
+    if (!file)
+      return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmpPath, path, ec);
+  return !ec;
+}
+
+bool restamp_cooked_file(const char *path, const SourceStamp &stamp)
+{
+  std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+  if (!file)
+    return false;
+  file.seekp(offsetof(CookedFileHeader, source));
+  file.write(reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+  return (bool)file;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// identifies the exact source a cooked file was made from
+struct SourceStamp
+{
+  uint64_t size;
+  int64_t time;
+  uint64_t hash;
+};
+
+// every cooked file starts with this, format specific header data follows it
+struct CookedFileHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint64_t settings; // import flags and format options the file was cooked with
+  uint32_t count;    // format specific, e.g. number of meshes cooked from the same source
+  uint32_t reserved;
+  SourceStamp source;
+};
+
+constexpr uint64_t CookedBlobAlignment = 16;
+
+struct CookedBlob
+{
+  uint64_t offset;
+  uint64_t size;
+};
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+bool make_source_stamp(const char *source_path, SourceStamp &stamp);
+
+// size and mtime are compared first, the content hash only when mtime moved (e.g. after a checkout)
+// a missing source is fine, shipped builds may contain only cooked data
+bool is_source_unchanged(const char *source_path, const SourceStamp &stamp);
+
+bool is_cooked_header_valid(const CookedFileHeader &header, uint32_t magic, uint32_t version, uint64_t settings);
+
+// lays blobs out after header_size bytes of header and fills their offsets into blob_table
+// data goes to a temporary file first, so readers never map a half written one
+bool write_cooked_file(const char *path, void *header, size_t header_size,
+  std::span<CookedBlob> blob_table, std::span<const std::span<const uint8_t>> blobs);
+
+// refreshes the stamp of a cooked file whose source was touched without changing
+bool restamp_cooked_file(const char *path, const SourceStamp &stamp);
+
+template<typename T>
+std::span<const uint8_t> as_blob(const std::vector<T> &v)
+{
+  return std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(v.data()), v.size() * sizeof(T));
+}
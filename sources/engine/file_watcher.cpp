@@ -0,0 +1,119 @@
+#include "file_watcher.h"
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "log.h"
+#include "task_queue.h"
+
+#ifdef __linux__
+#include <atomic>
+#include <thread>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+// directories are watched instead of files, an editor's rename over the file would end a file watch
+struct WatchedDirectory
+{
+  std::string path;
+  std::map<std::string, std::vector<std::function<void()>>> files; // file name -> callbacks
+};
+
+struct FileWatcher
+{
+  int fd = -1;
+  std::thread thread;
+  std::atomic<bool> stopping = false;
+  std::mutex mutex;
+  std::map<int, WatchedDirectory> directories; // by watch descriptor
+
+  void run()
+  {
+    alignas(inotify_event) char buffer[4096];
+    while (!stopping)
+    {
+      // short timeout, so stop doesn't need another wakeup source
+      pollfd pfd{fd, POLLIN, 0};
+      if (poll(&pfd, 1, 100) <= 0)
+        continue;
+      ssize_t length = read(fd, buffer, sizeof(buffer));
+      for (ssize_t offset = 0; offset < length;)
+      {
+        const inotify_event *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+        offset += sizeof(inotify_event) + event->len;
+        if (!event->len)
+          continue;
+        std::unique_lock lock(mutex);
+        auto dir = directories.find(event->wd);
+        if (dir == directories.end())
+          continue;
+        auto file = dir->second.files.find(event->name);
+        if (file == dir->second.files.end())
+          continue;
+        for (const std::function<void()> &callback : file->second)
+          run_on_main_thread(callback);
+      }
+    }
+  }
+
+  ~FileWatcher() { stop(); }
+
+  void stop()
+  {
+    stopping = true;
+    if (thread.joinable())
+      thread.join();
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+  }
+};
+
+static FileWatcher watcher;
+
+void watch_file(const std::string &path, std::function<void()> on_change)
+{
+  std::filesystem::path file = std::filesystem::absolute(path).lexically_normal();
+  std::unique_lock lock(watcher.mutex);
+  if (watcher.stopping)
+    return;
+  if (watcher.fd < 0)
+  {
+    watcher.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher.fd < 0)
+    {
+      debug_error("inotify isn't available, %s won't be watched", path.c_str());
+      return;
+    }
+    watcher.thread = std::thread([]() { watcher.run(); });
+  }
+  std::string directory = file.parent_path().string();
+  int wd = inotify_add_watch(watcher.fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd < 0)
+  {
+    debug_error("can't watch %s", directory.c_str());
+    return;
+  }
+  WatchedDirectory &watched = watcher.directories[wd];
+  watched.path = directory;
+  watched.files[file.filename().string()].push_back(std::move(on_change));
+}
+
+void stop_file_watcher()
+{
+  watcher.stop();
+}
+
+#else
+
+void watch_file(const std::string &path, std::function<void()>)
+{
+  debug_log("file watching isn't supported here, %s won't be reloaded", path.c_str());
+}
+
+void stop_file_watcher()
+{
+}
+
+#endif
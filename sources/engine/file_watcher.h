@@ -0,0 +1,9 @@
+#pragma once
+#include <functional>
+#include <string>
+
+// calls on_change on the main thread (through run_on_main_thread) after path is written or replaced
+// several callbacks per file are fine, editors that save through a temporary file are handled
+void watch_file(const std::string &path, std::function<void()> on_change);
+
+void stop_file_watcher();
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// 32 bit fnv-1a, constexpr so names can be hashed at compile time
+constexpr uint32_t fnv1a32(std::string_view text)
+{
+  uint32_t hash = 0x811c9dc5u;
+  for (char c : text)
+  {
+    hash ^= (uint8_t)c;
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
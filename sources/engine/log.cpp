@@ -20,10 +20,11 @@ std::list<Message> &messages_list()
 }
 
 constexpr int messageLen = 1024, timeLen = 20;
-char messageBuf[messageLen], timeBuf[timeLen];
 
+// loaders log from worker threads too, so buffers are per call
 void debug_common(const char *fmt, int status, va_list args)
 {
+  char messageBuf[messageLen], timeBuf[timeLen];
   vsnprintf(messageBuf, messageLen, fmt, args);
   snprintf(timeBuf, timeLen, "[%.2f] ", get_time());
   std::unique_lock read_write_lock(m);
@@ -0,0 +1,75 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+MappedFile::~MappedFile()
+{
+  if (data)
+    UnmapViewOfFile(data);
+}
+
+MappedFilePtr map_file(const char *path)
+{
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+  {
+    CloseHandle(file);
+    return nullptr;
+  }
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (!mapping)
+    return nullptr;
+
+  const void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (!view)
+    return nullptr;
+
+  auto mapped = std::make_unique<MappedFile>();
+  mapped->data = static_cast<const uint8_t *>(view);
+  mapped->size = size.QuadPart;
+  return mapped;
+}
+
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile()
+{
+  if (data)
+    munmap(const_cast<uint8_t *>(data), size);
+}
+
+MappedFilePtr map_file(const char *path)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0)
+  {
+    close(fd);
+    return nullptr;
+  }
+  void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (view == MAP_FAILED)
+    return nullptr;
+
+  auto mapped = std::make_unique<MappedFile>();
+  mapped->data = static_cast<const uint8_t *>(view);
+  mapped->size = st.st_size;
+  return mapped;
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// read-only view of a whole file mapped into the address space
+struct MappedFile
+{
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+};
+
+using MappedFilePtr = std::unique_ptr<MappedFile>;
+
+MappedFilePtr map_file(const char *path);
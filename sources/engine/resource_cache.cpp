@@ -0,0 +1,28 @@
+#include "resource_cache.h"
+#include <algorithm>
+#include <vector>
+#include "log.h"
+
+static std::vector<const ResourceCacheBase *> &cache_list()
+{
+  static std::vector<const ResourceCacheBase *> caches;
+  return caches;
+}
+
+ResourceCacheBase::ResourceCacheBase(const char *name) : name(name)
+{
+  cache_list().push_back(this);
+}
+
+ResourceCacheBase::~ResourceCacheBase()
+{
+  auto &caches = cache_list();
+  caches.erase(std::remove(caches.begin(), caches.end(), this), caches.end());
+}
+
+void log_resource_cache_stats()
+{
+  for (const ResourceCacheBase *cache : cache_list())
+    debug_log("%s cache: %llu hits, %llu misses, %zu alive", cache->name,
+      (unsigned long long)cache->stats.hits, (unsigned long long)cache->stats.misses, cache->alive_count());
+}
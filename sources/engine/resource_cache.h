@@ -0,0 +1,160 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include "async_resource.h"
+
+struct ResourceCacheStats
+{
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+};
+
+class ResourceCacheBase
+{
+public:
+  const char *const name;
+  ResourceCacheStats stats;
+
+  ResourceCacheBase(const char *name);
+  ResourceCacheBase(const ResourceCacheBase &) = delete;
+  virtual ~ResourceCacheBase();
+  virtual size_t alive_count() const = 0;
+};
+
+// shares resources by key (path plus whatever load parameters change the result)
+// entries are weak, a resource is freed with its last user and loaded again on the next request
+// caches are main thread only, like the GL objects they hold
+template<typename T>
+class ResourceCache : public ResourceCacheBase
+{
+  std::map<std::string, std::weak_ptr<T>> entries;
+
+public:
+  using ResourceCacheBase::ResourceCacheBase;
+
+  // create is called on a miss, failed loads (nullptr) aren't cached
+  template<typename Create>
+  std::shared_ptr<T> get_or_create(const std::string &key, Create &&create)
+  {
+    auto it = entries.find(key);
+    if (it != entries.end())
+    {
+      if (std::shared_ptr<T> resource = it->second.lock())
+      {
+        stats.hits++;
+        return resource;
+      }
+    }
+    stats.misses++;
+    std::shared_ptr<T> resource = create();
+    if (resource)
+      entries[key] = resource;
+    else if (it != entries.end())
+      entries.erase(it);
+    return resource;
+  }
+
+  // nullptr when the key isn't loaded, doesn't count as a hit or a miss
+  std::shared_ptr<T> find(const std::string &key) const
+  {
+    auto it = entries.find(key);
+    return it != entries.end() ? it->second.lock() : nullptr;
+  }
+
+  // registers a resource loaded elsewhere, doesn't count as a hit or a miss either
+  void insert(const std::string &key, std::shared_ptr<T> resource)
+  {
+    entries[key] = std::move(resource);
+  }
+
+  size_t alive_count() const override
+  {
+    size_t count = 0;
+    for (const auto &[key, resource] : entries)
+      count += !resource.expired();
+    return count;
+  }
+};
+
+// one cache for blocking and background loads of a resource type, so mixing them never loads a key twice
+// a background load publishes its result to the shared entries, a blocking load of a key that is still loading
+// in the background resolves the waiting handles right away
+template<typename T>
+class AsyncResourceCache
+{
+  ResourceCache<T> resources;
+  std::map<std::string, std::weak_ptr<AsyncResource<T>>> pending;
+
+  void resolve_pending(const std::string &key, const std::shared_ptr<T> &resource)
+  {
+    auto it = pending.find(key);
+    if (it == pending.end())
+      return;
+    if (AsyncResourcePtr<T> handle = it->second.lock())
+      handle->resolve(resource);
+    pending.erase(it);
+  }
+
+public:
+  AsyncResourceCache(const char *name) : resources(name) {}
+
+  template<typename Load>
+  std::shared_ptr<T> get_or_load(const std::string &key, Load &&load)
+  {
+    std::shared_ptr<T> resource = resources.get_or_create(key, std::forward<Load>(load));
+    if (resource)
+      resolve_pending(key, resource);
+    return resource;
+  }
+
+  // start begins the background load, which has to end with finish(key, result) on the main thread
+  template<typename Start>
+  AsyncResourcePtr<T> get_or_start(const std::string &key, std::shared_ptr<T> placeholder, Start &&start)
+  {
+    if (auto it = pending.find(key); it != pending.end())
+    {
+      if (AsyncResourcePtr<T> handle = it->second.lock())
+      {
+        resources.stats.hits++;
+        return handle;
+      }
+    }
+    auto handle = std::make_shared<AsyncResource<T>>(std::move(placeholder));
+    if (std::shared_ptr<T> resource = resources.find(key))
+    {
+      resources.stats.hits++;
+      handle->resolve(std::move(resource));
+      return handle;
+    }
+    resources.stats.misses++;
+    // a load already running for an abandoned handle just publishes into the entries
+    bool running = pending.count(key) > 0;
+    pending[key] = handle;
+    if (!running)
+      start();
+    return handle;
+  }
+
+  // a resource loaded by a blocking call in the meantime wins, the late one is dropped
+  // get_or_start already counted the miss, so this doesn't touch the stats
+  void finish(const std::string &key, std::shared_ptr<T> loaded)
+  {
+    if (loaded)
+    {
+      if (std::shared_ptr<T> existing = resources.find(key))
+        loaded = std::move(existing);
+      else
+        resources.insert(key, loaded);
+    }
+    auto it = pending.find(key);
+    if (it == pending.end())
+      return;
+    if (AsyncResourcePtr<T> handle = it->second.lock())
+      handle->resolve(std::move(loaded));
+    pending.erase(it);
+  }
+};
+
+void log_resource_cache_stats();
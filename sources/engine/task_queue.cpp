@@ -0,0 +1,106 @@
+#include "task_queue.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct WorkerPool
+{
+  std::mutex mutex;
+  std::condition_variable wakeUp;
+  std::deque<std::function<void()>> jobs;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+
+  void work()
+  {
+    while (true)
+    {
+      std::function<void()> job;
+      {
+        std::unique_lock lock(mutex);
+        wakeUp.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (stopping)
+          return;
+        job = std::move(jobs.front());
+        jobs.pop_front();
+      }
+      job();
+    }
+  }
+
+  ~WorkerPool() { stop(); }
+
+  void stop()
+  {
+    {
+      std::unique_lock lock(mutex);
+      stopping = true;
+      jobs.clear();
+    }
+    wakeUp.notify_all();
+    for (std::thread &thread : threads)
+      thread.join();
+    threads.clear();
+  }
+};
+
+static WorkerPool workers;
+
+static std::mutex mainThreadMutex;
+static std::deque<std::function<void()>> mainThreadJobs;
+
+void run_async(std::function<void()> job)
+{
+  {
+    std::unique_lock lock(workers.mutex);
+    if (workers.stopping)
+      return;
+    if (workers.threads.empty())
+    {
+      // one core stays for the main thread
+      unsigned count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+      for (unsigned i = 0; i < count; i++)
+        workers.threads.emplace_back([]() { workers.work(); });
+    }
+    workers.jobs.push_back(std::move(job));
+  }
+  workers.wakeUp.notify_one();
+}
+
+void run_on_main_thread(std::function<void()> job)
+{
+  std::unique_lock lock(mainThreadMutex);
+  mainThreadJobs.push_back(std::move(job));
+}
+
+void process_main_thread_jobs(float time_budget_ms)
+{
+  auto start = std::chrono::high_resolution_clock::now();
+  while (true)
+  {
+    std::function<void()> job;
+    {
+      std::unique_lock lock(mainThreadMutex);
+      if (mainThreadJobs.empty())
+        return;
+      job = std::move(mainThreadJobs.front());
+      mainThreadJobs.pop_front();
+    }
+    job();
+
+    std::chrono::duration<float, std::milli> spent = std::chrono::high_resolution_clock::now() - start;
+    if (spent.count() >= time_budget_ms)
+      return;
+  }
+}
+
+void stop_workers()
+{
+  workers.stop();
+  std::unique_lock lock(mainThreadMutex);
+  mainThreadJobs.clear();
+}
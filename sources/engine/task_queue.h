@@ -0,0 +1,15 @@
+#pragma once
+#include <functional>
+
+// runs job on one of the worker threads, jobs must not touch GL
+void run_async(std::function<void()> job);
+
+// queues job for the main thread, where the GL context lives
+void run_on_main_thread(std::function<void()> job);
+
+// called by the main loop once a frame, runs queued main thread jobs until time_budget_ms is spent
+// at least one job runs per call, so uploads can't starve
+void process_main_thread_jobs(float time_budget_ms);
+
+// waits for the running worker jobs and drops the queued ones
+void stop_workers();
@@ -2,7 +2,12 @@
 #include <render/direction_light.h>
 #include <render/material.h>
 #include <render/mesh.h>
+#include <render/gpu_buffer.h>
+#include <render/global_render_data.h>
 #include "camera.h"
+#include <algorithm>
+#include <span>
+#include <tuple>
 #include <application.h>
 
 struct UserCamera
@@ -15,8 +20,16 @@ struct UserCamera
 struct Character
 {
   glm::mat4 transform;
-  MeshPtr mesh;
+  MeshHandle mesh;
   MaterialPtr material;
+  int lod = 0;
+};
+
+// std430 Instance of character_vs.glsl
+struct CharacterInstance
+{
+  mat4 transform;
+  uvec4 textureLayers;
 };
 
 struct Scene
@@ -27,6 +40,9 @@ struct Scene
 
   std::vector<Character> characters;
 
+  GpuBuffer globalRenderData{GL_UNIFORM_BUFFER};
+  GpuBuffer instanceBuffer{GL_SHADER_STORAGE_BUFFER};
+  std::vector<CharacterInstance> instances;
 };
 
 static std::unique_ptr<Scene> scene;
@@ -60,17 +76,24 @@ void game_init()
 
   auto material = make_material("character", "sources/shaders/character_vs.glsl", "sources/shaders/character_ps.glsl");
   std::fflush(stdout);
-  material->set_property("mainTex", create_texture2d("resources/MotusMan_v55/MCG_diff.jpg"));
+  material->set_property("mainTex", load_texture_layer_async("resources/MotusMan_v55/MCG_diff.jpg"));
+  material->set_property("shininess", 1.3f);
+  material->set_property("metallness", 0.4f);
 
   scene->characters.emplace_back(Character{
     glm::identity<glm::mat4>(),
-    load_mesh("resources/MotusMan_v55/MotusMan_v55.fbx", 0),
+    load_mesh_async("resources/MotusMan_v55/MotusMan_v55.fbx", 0),
     std::move(material)
   });
   std::fflush(stdout);
 }
 
 
+void game_shutdown()
+{
+  scene.reset();
+}
+
 void game_update()
 {
   arcball_camera_update(
@@ -79,21 +102,35 @@ void game_update()
     get_delta_time());
 }
 
-void render_character(const Character &character, const mat4 &cameraProjView, vec3 cameraPosition, const DirectionLight &light)
+// characters of one batch share mesh, lod and material bindings, only transforms and texture layers differ
+void render_characters(std::span<const Character *const> batch)
 {
-  const Material &material = *character.material;
+  const Character &first = *batch[0];
+  const Material &material = *first.material;
   const Shader &shader = material.get_shader();
 
+  scene->instances.clear();
+  for (const Character *character : batch)
+    scene->instances.push_back(CharacterInstance{character->transform, character->material->get_texture_layers()});
+  scene->instanceBuffer.update(std::span<const CharacterInstance>(scene->instances));
+
   shader.use();
   material.bind_uniforms_to_shader();
-  shader.set_mat4x4("Transform", character.transform);
-  shader.set_mat4x4("ViewProjection", cameraProjView);
-  shader.set_vec3("CameraPosition", cameraPosition);
-  shader.set_vec3("LightDirection", glm::normalize(light.lightDirection));
-  shader.set_vec3("AmbientLight", light.ambient);
-  shader.set_vec3("SunLight", light.lightColor);
-
-  render(character.mesh);
+  scene->instanceBuffer.bind(1);
+
+  render_instanced(first.mesh->get(), first.lod, batch.size());
+}
+
+// picks the coarsest lod whose simplification error stays under a pixel at the character's distance
+// character textures are array layers, which keep their whole mip chain resident, so there is nothing to stream
+static void update_character_lod(Character &character, const UserCamera &camera)
+{
+  vec3 cameraPosition = vec3(camera.transform[3]);
+  vec3 position = vec3(character.transform[3]);
+  float scale = max(length(vec3(character.transform[0])), max(length(vec3(character.transform[1])), length(vec3(character.transform[2]))));
+  float distance = max(length(position - cameraPosition), 0.01f);
+  float pixelsPerUnit = 0.5f * get_screen_height() * camera.projection[1][1] * scale / distance;
+  character.lod = select_lod(*character.mesh->get(), pixelsPerUnit);
 }
 
 void game_render()
@@ -107,8 +144,47 @@ void game_render()
 
   const mat4 &projection = scene->userCamera.projection;
   const glm::mat4 &transform = scene->userCamera.transform;
-  mat4 projView = projection * inverse(transform);
 
-  for (const Character &character : scene->characters)
-    render_character(character, projView, glm::vec3(transform[3]), scene->light);
+  GlobalRenderData globalData{};
+  globalData.viewProjection = projection * inverse(transform);
+  globalData.cameraPosition = vec3(transform[3]);
+  globalData.lightDirection = glm::normalize(scene->light.lightDirection);
+  globalData.ambientLight = scene->light.ambient;
+  globalData.sunLight = scene->light.lightColor;
+  scene->globalRenderData.update(globalData);
+  scene->globalRenderData.bind(GlobalRenderDataBinding);
+
+  std::vector<const Character *> visible;
+  for (Character &character : scene->characters)
+  {
+    // still loading
+    if (!character.mesh->get())
+      continue;
+    update_character_lod(character, scene->userCamera);
+    visible.push_back(&character);
+  }
+
+  // batches are runs of the same mesh, lod and bindings, the sort key has to make those runs contiguous
+  std::vector<std::pair<uint64_t, const Character *>> keyed;
+  keyed.reserve(visible.size());
+  for (const Character *character : visible)
+    keyed.emplace_back(character->material->binding_key(), character);
+  std::sort(keyed.begin(), keyed.end(), [](const auto &a, const auto &b)
+  {
+    return std::make_tuple(a.second->mesh->get().get(), a.second->lod, a.first) <
+      std::make_tuple(b.second->mesh->get().get(), b.second->lod, b.first);
+  });
+  for (size_t i = 0; i < keyed.size(); i++)
+    visible[i] = keyed[i].second;
+  for (size_t begin = 0, end; begin < visible.size(); begin = end)
+  {
+    const Character &first = *visible[begin];
+    for (end = begin + 1; end < visible.size(); end++)
+    {
+      const Character &next = *visible[end];
+      if (next.mesh->get() != first.mesh->get() || next.lod != first.lod || !next.material->shares_bindings(*first.material))
+        break;
+    }
+    render_characters(std::span(visible).subspan(begin, end - begin));
+  }
 }
\ No newline at end of file
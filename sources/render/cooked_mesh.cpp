@@ -0,0 +1,76 @@
+#include "cooked_mesh.h"
+#include <log.h>
+
+std::string cooked_mesh_path(const char *source_path, int idx)
+{
+  return std::string(source_path) + "." + std::to_string(idx) + ".mesh";
+}
+
+CookedMeshPtr open_cooked_mesh(const char *path, const char *source_path, uint64_t settings)
+{
+  MappedFilePtr file = map_file(path);
+  if (!file || file->size < sizeof(CookedMeshHeader))
+    return nullptr;
+
+  const auto *header = reinterpret_cast<const CookedMeshHeader *>(file->data);
+  if (!is_cooked_header_valid(header->file, CookedMeshMagic, CookedMeshVersion, settings))
+    return nullptr;
+
+  if (!is_source_unchanged(source_path, header->file.source))
+  {
+    debug_log("cooked mesh %s is stale", path);
+    return nullptr;
+  }
+
+  if (header->vertexFormat >= MeshVertexFormat::Count || header->vertexStride != vertex_stride(header->vertexFormat) ||
+      (header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t)) ||
+      header->blobs[(int)CookedMeshChannel::Vertices].size != (uint64_t)header->vertexCount * header->vertexStride)
+  {
+    debug_error("cooked mesh %s is broken", path);
+    return nullptr;
+  }
+
+  for (const CookedBlob &blob : header->blobs)
+  {
+    if (blob.offset % CookedBlobAlignment != 0 || blob.offset > file->size || blob.size > file->size - blob.offset)
+    {
+      debug_error("cooked mesh %s is broken", path);
+      return nullptr;
+    }
+  }
+
+  const uint64_t indexCount = header->blobs[(int)CookedMeshChannel::Indices].size / header->indexSize;
+  const CookedBlob &lods = header->blobs[(int)CookedMeshChannel::Lods];
+  const MeshLod *lod = reinterpret_cast<const MeshLod *>(file->data + lods.offset);
+  for (size_t i = 0; i < lods.size / sizeof(MeshLod); i++)
+  {
+    if ((uint64_t)lod[i].firstIndex + lod[i].indexCount > indexCount)
+    {
+      debug_error("cooked mesh %s is broken", path);
+      return nullptr;
+    }
+  }
+
+  auto cooked = std::make_unique<CookedMesh>();
+  cooked->header = header;
+  cooked->file = std::move(file);
+  return cooked;
+}
+
+bool save_cooked_mesh(const char *path, const SourceStamp &source, uint64_t settings, int mesh_count,
+  MeshVertexFormat format, const MeshData &mesh)
+{
+  CookedMeshHeader header{};
+  header.file = {CookedMeshMagic, CookedMeshVersion, settings, (uint32_t)mesh_count, 0, source};
+  header.vertexFormat = format;
+  header.vertexCount = mesh.vertices.size();
+  header.vertexStride = vertex_stride(format);
+  header.boundingRadius = bounding_radius(mesh);
+
+  std::vector<uint8_t> indices = pack_indices(mesh, header.indexSize);
+  std::vector<uint8_t> vertices = interleave_vertices(mesh, format);
+  const std::span<const uint8_t> blobs[] = {as_blob(indices), as_blob(vertices), as_blob(mesh.lods)};
+  static_assert(std::size(blobs) == (size_t)CookedMeshChannel::Count);
+
+  return write_cooked_file(path, &header, sizeof(header), header.blobs, blobs);
+}
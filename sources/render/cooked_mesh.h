@@ -0,0 +1,54 @@
+#pragma once
+#include <span>
+#include <string>
+#include <mapped_file.h>
+#include <cooked_file.h>
+#include "mesh_data.h"
+
+enum class CookedMeshChannel : uint32_t
+{
+  Indices,
+  Vertices, // interleaved in vertexFormat
+  Lods,     // MeshLod ranges of the index blob
+  Count
+};
+
+// file = header + blobs, every blob is 16 byte aligned and has exactly the layout create_mesh uploads
+// file.count is the number of meshes cooked from the same source
+struct CookedMeshHeader
+{
+  CookedFileHeader file;
+  MeshVertexFormat vertexFormat;
+  uint32_t vertexCount;
+  uint32_t vertexStride;
+  uint32_t indexSize;
+  float boundingRadius;
+  uint32_t reserved;
+  CookedBlob blobs[(int)CookedMeshChannel::Count];
+};
+
+constexpr uint32_t CookedMeshMagic = 0x48534d43; // "CMSH"
+constexpr uint32_t CookedMeshVersion = 8;
+
+struct CookedMesh
+{
+  MappedFilePtr file;
+  const CookedMeshHeader *header = nullptr;
+
+  template<typename T>
+  std::span<const T> channel(CookedMeshChannel c) const
+  {
+    const CookedBlob &blob = header->blobs[(int)c];
+    return std::span<const T>(reinterpret_cast<const T *>(file->data + blob.offset), blob.size / sizeof(T));
+  }
+};
+
+using CookedMeshPtr = std::unique_ptr<CookedMesh>;
+
+std::string cooked_mesh_path(const char *source_path, int idx);
+
+// returns nullptr when cooked file is missing, broken or made from another source or settings
+CookedMeshPtr open_cooked_mesh(const char *path, const char *source_path, uint64_t settings);
+
+bool save_cooked_mesh(const char *path, const SourceStamp &source, uint64_t settings, int mesh_count,
+  MeshVertexFormat format, const MeshData &mesh);
@@ -0,0 +1,120 @@
+#include "cooked_model.h"
+#include <mapped_file.h>
+#include <log.h>
+
+std::string cooked_model_path(const char *source_path)
+{
+  return std::string(source_path) + ".model";
+}
+
+template<typename T>
+static std::span<const T> model_channel(const MappedFile &file, const CookedModelHeader &header, CookedModelChannel c)
+{
+  const CookedBlob &blob = header.blobs[(int)c];
+  return std::span<const T>(reinterpret_cast<const T *>(file.data + blob.offset), blob.size / sizeof(T));
+}
+
+bool open_cooked_model(const char *path, const char *source_path, uint64_t settings, ModelData &model, int &mesh_count)
+{
+  MappedFilePtr file = map_file(path);
+  if (!file || file->size < sizeof(CookedModelHeader))
+    return false;
+
+  const auto *header = reinterpret_cast<const CookedModelHeader *>(file->data);
+  if (!is_cooked_header_valid(header->file, CookedModelMagic, CookedModelVersion, settings))
+    return false;
+
+  if (!is_source_unchanged(source_path, header->file.source))
+  {
+    debug_log("cooked model %s is stale", path);
+    return false;
+  }
+
+  for (const CookedBlob &blob : header->blobs)
+  {
+    if (blob.offset % CookedBlobAlignment != 0 || blob.offset > file->size || blob.size > file->size - blob.offset)
+    {
+      debug_error("cooked model %s is broken", path);
+      return false;
+    }
+  }
+
+  auto nodes = model_channel<CookedModelNode>(*file, *header, CookedModelChannel::Nodes);
+  auto nodeMeshes = model_channel<uint32_t>(*file, *header, CookedModelChannel::NodeMeshes);
+  auto materials = model_channel<CookedModelMaterial>(*file, *header, CookedModelChannel::Materials);
+  auto meshMaterials = model_channel<uint32_t>(*file, *header, CookedModelChannel::MeshMaterials);
+  auto bones = model_channel<CookedModelBone>(*file, *header, CookedModelChannel::Bones);
+  auto strings = model_channel<char>(*file, *header, CookedModelChannel::Strings);
+  const uint32_t meshCount = header->file.count;
+
+  bool valid = meshMaterials.size() == meshCount && (strings.empty() || strings.back() == '\0');
+  for (size_t i = 0; i < nodes.size() && valid; i++)
+  {
+    const CookedModelNode &node = nodes[i];
+    valid = node.parent < (int32_t)i && node.name < strings.size() &&
+      (uint64_t)node.firstMesh + node.meshCount <= nodeMeshes.size();
+  }
+  for (uint32_t mesh : nodeMeshes)
+    valid = valid && mesh < meshCount;
+  for (const CookedModelMaterial &material : materials)
+    valid = valid && material.name < strings.size() && material.diffuseTexture < strings.size();
+  for (uint32_t material : meshMaterials)
+    valid = valid && material < materials.size();
+  for (const CookedModelBone &bone : bones)
+    valid = valid && bone.node < (int32_t)nodes.size() && bone.name < strings.size();
+  if (!valid)
+  {
+    debug_error("cooked model %s is broken", path);
+    return false;
+  }
+
+  model = ModelData();
+  for (const CookedModelNode &node : nodes)
+  {
+    const uint32_t *meshes = nodeMeshes.data() + node.firstMesh;
+    model.nodes.push_back(ModelNode{strings.data() + node.name, node.parent, node.localTransform,
+      std::vector<uint32_t>(meshes, meshes + node.meshCount)});
+  }
+  for (const CookedModelMaterial &material : materials)
+    model.materials.push_back(ModelMaterial{strings.data() + material.name, strings.data() + material.diffuseTexture});
+  model.meshMaterials.assign(meshMaterials.begin(), meshMaterials.end());
+  for (const CookedModelBone &bone : bones)
+    model.bones.push_back(ModelBone{strings.data() + bone.name, bone.node, bone.inverseBindPose});
+  mesh_count = meshCount;
+  return true;
+}
+
+static uint32_t add_string(std::vector<char> &strings, const std::string &s)
+{
+  uint32_t offset = strings.size();
+  strings.insert(strings.end(), s.c_str(), s.c_str() + s.size() + 1);
+  return offset;
+}
+
+bool save_cooked_model(const char *path, const SourceStamp &source, uint64_t settings, int mesh_count, const ModelData &model)
+{
+  CookedModelHeader header{};
+  header.file = {CookedModelMagic, CookedModelVersion, settings, (uint32_t)mesh_count, 0, source};
+
+  std::vector<CookedModelNode> nodes;
+  std::vector<uint32_t> nodeMeshes;
+  std::vector<CookedModelMaterial> materials;
+  std::vector<CookedModelBone> bones;
+  std::vector<char> strings;
+  for (const ModelNode &node : model.nodes)
+  {
+    nodes.push_back(CookedModelNode{node.localTransform, node.parent, add_string(strings, node.name),
+      (uint32_t)nodeMeshes.size(), (uint32_t)node.meshes.size()});
+    nodeMeshes.insert(nodeMeshes.end(), node.meshes.begin(), node.meshes.end());
+  }
+  for (const ModelMaterial &material : model.materials)
+    materials.push_back(CookedModelMaterial{add_string(strings, material.name), add_string(strings, material.diffuseTexture)});
+  for (const ModelBone &bone : model.bones)
+    bones.push_back(CookedModelBone{bone.inverseBindPose, bone.node, add_string(strings, bone.name)});
+
+  const std::span<const uint8_t> blobs[] = {
+    as_blob(nodes), as_blob(nodeMeshes), as_blob(materials), as_blob(model.meshMaterials), as_blob(bones), as_blob(strings)};
+  static_assert(std::size(blobs) == (size_t)CookedModelChannel::Count);
+
+  return write_cooked_file(path, &header, sizeof(header), header.blobs, blobs);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <cooked_file.h>
+#include "model_data.h"
+
+enum class CookedModelChannel : uint32_t
+{
+  Nodes,         // CookedModelNode
+  NodeMeshes,    // uint32_t mesh indices, ranges of it belong to nodes
+  Materials,     // CookedModelMaterial
+  MeshMaterials, // uint32_t per mesh
+  Bones,         // CookedModelBone
+  Strings,       // zero terminated names, records refer to them by offset
+  Count
+};
+
+struct CookedModelNode
+{
+  mat4 localTransform;
+  int32_t parent;
+  uint32_t name;
+  uint32_t firstMesh;
+  uint32_t meshCount;
+};
+
+struct CookedModelMaterial
+{
+  uint32_t name;
+  uint32_t diffuseTexture;
+};
+
+struct CookedModelBone
+{
+  mat4 inverseBindPose;
+  int32_t node;
+  uint32_t name;
+};
+
+// file.count is the number of meshes cooked from the same source
+struct CookedModelHeader
+{
+  CookedFileHeader file;
+  CookedBlob blobs[(int)CookedModelChannel::Count];
+};
+
+constexpr uint32_t CookedModelMagic = 0x4c444d43; // "CMDL"
+constexpr uint32_t CookedModelVersion = 1;
+
+std::string cooked_model_path(const char *source_path);
+
+// fills model and returns true only when cooked file is intact and made from this source and settings
+bool open_cooked_model(const char *path, const char *source_path, uint64_t settings, ModelData &model, int &mesh_count);
+
+bool save_cooked_model(const char *path, const SourceStamp &source, uint64_t settings, int mesh_count, const ModelData &model);
@@ -0,0 +1,64 @@
+#include "cooked_texture.h"
+#include <algorithm>
+#include <log.h>
+
+std::string cooked_texture_path(const char *source_path)
+{
+  return std::string(source_path) + ".tex";
+}
+
+CookedTexturePtr open_cooked_texture(const char *path, const char *source_path, uint64_t settings)
+{
+  MappedFilePtr file = map_file(path);
+  if (!file || file->size < sizeof(CookedTextureHeader))
+    return nullptr;
+
+  const auto *header = reinterpret_cast<const CookedTextureHeader *>(file->data);
+  if (!is_cooked_header_valid(header->file, CookedTextureMagic, CookedTextureVersion, settings))
+    return nullptr;
+
+  if (!is_source_unchanged(source_path, header->file.source))
+  {
+    debug_log("cooked texture %s is stale", path);
+    return nullptr;
+  }
+
+  if (header->format >= TextureFormat::Count || header->width == 0 || header->height == 0 ||
+      header->levelCount == 0 || header->levelCount > CookedTextureMaxLevels)
+  {
+    debug_error("cooked texture %s is broken", path);
+    return nullptr;
+  }
+  for (uint32_t i = 0; i < header->levelCount; i++)
+  {
+    const CookedBlob &blob = header->levels[i];
+    const uint32_t width = std::max(1u, header->width >> i), height = std::max(1u, header->height >> i);
+    if (blob.offset > file->size || blob.size > file->size - blob.offset ||
+        blob.size != texture_level_size(header->format, width, height))
+    {
+      debug_error("cooked texture %s is broken", path);
+      return nullptr;
+    }
+  }
+
+  auto cooked = std::make_unique<CookedTexture>();
+  cooked->header = header;
+  cooked->file = std::move(file);
+  return cooked;
+}
+
+bool save_cooked_texture(const char *path, const SourceStamp &source, uint64_t settings,
+  TextureFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> &levels)
+{
+  CookedTextureHeader header{};
+  header.file = {CookedTextureMagic, CookedTextureVersion, settings, 1, 0, source};
+  header.format = format;
+  header.width = width;
+  header.height = height;
+  header.levelCount = std::min<size_t>(levels.size(), CookedTextureMaxLevels);
+
+  std::vector<std::span<const uint8_t>> blobs;
+  for (uint32_t i = 0; i < header.levelCount; i++)
+    blobs.push_back(as_blob(levels[i]));
+  return write_cooked_file(path, &header, sizeof(header), std::span(header.levels, header.levelCount), blobs);
+}
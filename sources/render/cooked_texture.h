@@ -0,0 +1,46 @@
+#pragma once
+#include <span>
+#include <string>
+#include <mapped_file.h>
+#include <cooked_file.h>
+#include "texture_compressor.h"
+
+constexpr int CookedTextureMaxLevels = 16;
+
+// file = header + one blob per mip level, level 0 first, the chain goes down to 1x1
+// level i is max(1, width >> i) by max(1, height >> i) pixels in format
+struct CookedTextureHeader
+{
+  CookedFileHeader file;
+  TextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t levelCount;
+  CookedBlob levels[CookedTextureMaxLevels];
+};
+
+constexpr uint32_t CookedTextureMagic = 0x58455443; // "CTEX"
+constexpr uint32_t CookedTextureVersion = 3;
+
+struct CookedTexture
+{
+  MappedFilePtr file;
+  const CookedTextureHeader *header = nullptr;
+
+  std::span<const uint8_t> level(int i) const
+  {
+    const CookedBlob &blob = header->levels[i];
+    return std::span<const uint8_t>(file->data + blob.offset, blob.size);
+  }
+};
+
+using CookedTexturePtr = std::unique_ptr<CookedTexture>;
+
+std::string cooked_texture_path(const char *source_path);
+
+// returns nullptr when cooked file is missing, broken or made from another source or settings
+CookedTexturePtr open_cooked_texture(const char *path, const char *source_path, uint64_t settings);
+
+// levels are already in format, levels[0] is width x height
+bool save_cooked_texture(const char *path, const SourceStamp &source, uint64_t settings,
+  TextureFormat format, uint32_t width, uint32_t height, const std::vector<std::vector<uint8_t>> &levels);
@@ -0,0 +1,154 @@
+#include "geometry_arena.h"
+#include <algorithm>
+#include "glad/glad.h"
+
+constexpr uint64_t InitialArenaVertices = 1 << 16;
+constexpr uint64_t InitialArenaIndexBytes = 1 << 20;
+
+// skip glBindVertexArray when the arena is already bound, i.e. between characters
+static GLuint boundVertexArray = 0;
+
+uint64_t RangeAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+  for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it)
+  {
+    uint64_t offset = (it->first + alignment - 1) / alignment * alignment;
+    uint64_t end = it->first + it->second;
+    if (offset + size > end)
+      continue;
+    uint64_t blockOffset = it->first;
+    freeBlocks.erase(it);
+    if (offset > blockOffset)
+      freeBlocks.emplace(blockOffset, offset - blockOffset);
+    if (offset + size < end)
+      freeBlocks.emplace(offset + size, end - offset - size);
+    return offset;
+  }
+  return InvalidOffset;
+}
+
+void RangeAllocator::free(uint64_t offset, uint64_t size)
+{
+  if (size == 0)
+    return;
+  auto next = freeBlocks.lower_bound(offset);
+  if (next != freeBlocks.end() && offset + size == next->first)
+  {
+    size += next->second;
+    next = freeBlocks.erase(next);
+  }
+  if (next != freeBlocks.begin())
+  {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset)
+    {
+      prev->second += size;
+      return;
+    }
+  }
+  freeBlocks.emplace(offset, size);
+}
+
+void RangeAllocator::grow(uint64_t new_capacity)
+{
+  if (new_capacity <= capacity)
+    return;
+  uint64_t oldCapacity = capacity;
+  capacity = new_capacity;
+  free(oldCapacity, new_capacity - oldCapacity);
+}
+
+static GLuint resize_buffer(GLuint buffer, uint64_t old_size, uint64_t new_size)
+{
+  GLuint newBuffer;
+  glGenBuffers(1, &newBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, new_size, nullptr, GL_STATIC_DRAW);
+  if (buffer)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, old_size);
+    glDeleteBuffers(1, &buffer);
+  }
+  return newBuffer;
+}
+
+GeometryArena::GeometryArena(uint32_t stride, void (*init_format)()) : stride(stride)
+{
+  glGenVertexArrays(1, &vertexArrayObject);
+  glBindVertexArray(vertexArrayObject);
+  boundVertexArray = vertexArrayObject;
+  init_format();
+  reserve(InitialArenaVertices, InitialArenaIndexBytes);
+}
+
+GeometryArena::~GeometryArena()
+{
+  if (boundVertexArray == vertexArrayObject)
+    boundVertexArray = 0;
+  glDeleteVertexArrays(1, &vertexArrayObject);
+  glDeleteBuffers(1, &vertexBuffer);
+  glDeleteBuffers(1, &indexBuffer);
+}
+
+void GeometryArena::reserve(uint64_t vertex_count, uint64_t index_bytes)
+{
+  // offsets of live ranges stay valid, the data is copied to the bigger buffers
+  if (vertex_count > vertices.get_capacity())
+  {
+    vertexBuffer = resize_buffer(vertexBuffer, vertices.get_capacity() * stride, vertex_count * stride);
+    vertices.grow(vertex_count);
+  }
+  if (index_bytes > indices.get_capacity())
+  {
+    indexBuffer = resize_buffer(indexBuffer, indices.get_capacity(), index_bytes);
+    indices.grow(index_bytes);
+  }
+  glBindVertexArray(vertexArrayObject);
+  boundVertexArray = vertexArrayObject;
+  glBindVertexBuffer(0, vertexBuffer, 0, stride);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+}
+
+GeometryRange GeometryArena::allocate(std::span<const uint8_t> vertex_data, std::span<const uint8_t> index_data, uint32_t index_size)
+{
+  GeometryRange range;
+  range.vertexCount = vertex_data.size() / stride;
+  range.indexSize = index_data.size();
+
+  uint64_t baseVertex = vertices.allocate(range.vertexCount, 1);
+  if (baseVertex == RangeAllocator::InvalidOffset)
+  {
+    reserve(std::max(vertices.get_capacity() * 2, vertices.get_capacity() + range.vertexCount), 0);
+    baseVertex = vertices.allocate(range.vertexCount, 1);
+  }
+  uint64_t indexOffset = indices.allocate(range.indexSize, index_size);
+  if (indexOffset == RangeAllocator::InvalidOffset)
+  {
+    reserve(0, std::max(indices.get_capacity() * 2, indices.get_capacity() + range.indexSize + index_size));
+    indexOffset = indices.allocate(range.indexSize, index_size);
+  }
+  range.baseVertex = baseVertex;
+  range.indexOffset = indexOffset;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, baseVertex * stride, vertex_data.size(), vertex_data.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+  glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset, index_data.size(), index_data.data());
+  return range;
+}
+
+void GeometryArena::free(const GeometryRange &range)
+{
+  vertices.free(range.baseVertex, range.vertexCount);
+  indices.free(range.indexOffset, range.indexSize);
+}
+
+void GeometryArena::bind() const
+{
+  if (boundVertexArray != vertexArrayObject)
+  {
+    glBindVertexArray(vertexArrayObject);
+    boundVertexArray = vertexArrayObject;
+  }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <span>
+
+// first fit allocator over [0, capacity) with coalescing of freed blocks
+class RangeAllocator
+{
+  std::map<uint64_t, uint64_t> freeBlocks; // offset -> size
+  uint64_t capacity = 0;
+
+public:
+  static constexpr uint64_t InvalidOffset = ~0ull;
+
+  uint64_t allocate(uint64_t size, uint64_t alignment);
+  void free(uint64_t offset, uint64_t size);
+  void grow(uint64_t new_capacity);
+  uint64_t get_capacity() const { return capacity; }
+};
+
+struct GeometryRange
+{
+  uint32_t baseVertex;
+  uint32_t vertexCount;
+  uint64_t indexOffset; // bytes
+  uint64_t indexSize;   // bytes
+};
+
+// shared vertex and index buffers for every mesh of one vertex format,
+// the VAO is set up once, so drawing another mesh of the format needs no rebinds
+class GeometryArena
+{
+  uint32_t vertexArrayObject = 0;
+  uint32_t vertexBuffer = 0;
+  uint32_t indexBuffer = 0;
+  const uint32_t stride;
+  RangeAllocator vertices; // in vertices
+  RangeAllocator indices;  // in bytes
+
+  void reserve(uint64_t vertex_count, uint64_t index_bytes);
+
+public:
+  GeometryArena(uint32_t stride, void (*init_format)());
+  GeometryArena(const GeometryArena &) = delete;
+  GeometryArena &operator=(const GeometryArena &) = delete;
+  ~GeometryArena();
+
+  GeometryRange allocate(std::span<const uint8_t> vertex_data, std::span<const uint8_t> index_data, uint32_t index_size);
+  void free(const GeometryRange &range);
+  void bind() const;
+};
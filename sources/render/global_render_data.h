@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include "3dmath.h"
+
+// frame constants shared by every program, std140 block GlobalRenderData of shaders/global_render_data.glsl
+struct GlobalRenderData
+{
+  mat4 viewProjection;
+  vec3 cameraPosition;
+  float pad0;
+  vec3 lightDirection;
+  float pad1;
+  vec3 ambientLight;
+  float pad2;
+  vec3 sunLight;
+  float pad3;
+};
+
+constexpr int GlobalRenderDataBinding = 0;
+constexpr const char *GlobalRenderDataBlock = "GlobalRenderData";
+
+// std140: mat4 is 64 bytes, every vec3 starts on 16 bytes
+static_assert(offsetof(GlobalRenderData, viewProjection) == 0);
+static_assert(offsetof(GlobalRenderData, cameraPosition) == 64);
+static_assert(offsetof(GlobalRenderData, lightDirection) == 80);
+static_assert(offsetof(GlobalRenderData, ambientLight) == 96);
+static_assert(offsetof(GlobalRenderData, sunLight) == 112);
+static_assert(sizeof(GlobalRenderData) == 128);
@@ -0,0 +1,25 @@
+#include "gpu_buffer.h"
+#include <algorithm>
+#include "glad/glad.h"
+
+GpuBuffer::~GpuBuffer()
+{
+  glDeleteBuffers(1, &buffer);
+}
+
+void GpuBuffer::update(const void *data, size_t size)
+{
+  if (!buffer)
+    glGenBuffers(1, &buffer);
+  glBindBuffer(target, buffer);
+  if (size > capacity)
+    capacity = std::max(size, capacity * 2);
+  glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(target, 0, size, data);
+  glBindBuffer(target, 0);
+}
+
+void GpuBuffer::bind(int binding) const
+{
+  glBindBufferBase(target, binding, buffer);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// buffer rewritten from the cpu, typically every frame, target is GL_UNIFORM_BUFFER, GL_SHADER_STORAGE_BUFFER
+// or any other indexed binding point, uniform buffer contents follow std140 rules of the glsl block it backs
+class GpuBuffer
+{
+  const uint32_t target;
+  uint32_t buffer = 0;
+  size_t capacity = 0;
+
+public:
+  GpuBuffer(uint32_t target) : target(target) {}
+  GpuBuffer(const GpuBuffer &) = delete;
+  GpuBuffer &operator=(const GpuBuffer &) = delete;
+  ~GpuBuffer();
+
+  // orphans the old contents, so the gpu may still read them while the new ones are written
+  void update(const void *data, size_t size);
+  void bind(int binding) const;
+
+  template<typename T>
+  void update(std::span<const T> data)
+  {
+    update(data.data(), data.size_bytes());
+  }
+
+  template<typename T>
+  void update(const T &data)
+  {
+    update(&data, sizeof(T));
+  }
+};
@@ -1,14 +1,82 @@
 #include "material.h"
+#include "texture_streaming.h"
+#include <cstring>
+#include <cooked_file.h>
 
+const TextureLayer *Material::get_layer(const MaterialProperty &value)
+{
+  if (const auto *v = std::get_if<TextureLayerPtr>(&value))
+    return v->get();
+  if (const auto *v = std::get_if<TextureLayerHandle>(&value))
+    return (*v)->get().get();
+  return nullptr;
+}
+
+Material::~Material()
+{
+  free_material_block(blockSlot);
+}
+
+void Material::update_uniform_indices() const
+{
+  if (shaderGeneration == shader->generation)
+    return;
+  shaderGeneration = shader->generation;
+  for (const Property &property : properties)
+    property.shaderUniformIdx = shader->find_uniform(property.id);
+  // the block layout comes from the program, it is packed again after a reload
+  blockData.assign(shader->materialBlockSize, 0);
+  for (const Property &property : properties)
+    write_block_property(property);
+  blockDirty = true;
+}
+
+// before the first bind the block isn't laid out yet, update_uniform_indices packs everything then
+void Material::write_block_property(const Property &property) const
+{
+  if (property.shaderUniformIdx < 0 || blockData.size() != (size_t)shader->materialBlockSize)
+    return;
+  int offset = shader->uniforms[property.shaderUniformIdx].materialBlockOffset;
+  if (offset < 0)
+    return;
+  std::visit([&](const auto &value)
+  {
+    using T = std::decay_t<decltype(value)>;
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, vec2> || std::is_same_v<T, vec3> || std::is_same_v<T, vec4>)
+    {
+      if (offset + sizeof(T) <= blockData.size())
+      {
+        memcpy(blockData.data() + offset, &value, sizeof(T));
+        blockDirty = true;
+      }
+    }
+  }, property.value);
+}
 
 void Material::bind_uniforms_to_shader() const
 {
+  update_uniform_indices();
   const auto &uniforms = shader->uniforms;
 
+  if (!blockData.empty())
+  {
+    if (blockSlot.size != blockData.size())
+    {
+      free_material_block(blockSlot);
+      blockSlot = allocate_material_block(blockData.size());
+      blockDirty = true;
+    }
+    if (blockDirty)
+      update_material_block(blockSlot, blockData.data());
+    blockDirty = false;
+    bind_material_block(blockSlot);
+  }
+
   int textureBinding = 0;
   for (const Property &property : properties)
   {
-
+    if (property.shaderUniformIdx < 0 || uniforms[property.shaderUniformIdx].materialBlockOffset >= 0)
+      continue;
     int location = uniforms[property.shaderUniformIdx].shaderLocation;
     if (const auto *v = std::get_if<float>(&property.value))
       shader->set_float(location, *v);
@@ -18,17 +86,92 @@ void Material::bind_uniforms_to_shader() const
       shader->set_vec3(location, *v);
     else if (const auto *v = std::get_if<glm::vec4>(&property.value))
       shader->set_vec4(location, *v);
-    else if (const auto *v = std::get_if<Texture2DPtr>(&property.value))
+    else if (std::holds_alternative<Texture2DPtr>(property.value) || std::holds_alternative<Texture2DHandle>(property.value))
     {
-      unsigned textureObject = (*v)->textureObject;
+      const auto *handle = std::get_if<Texture2DHandle>(&property.value);
+      unsigned textureObject = handle ? (*handle)->get()->textureObject : std::get<Texture2DPtr>(property.value)->textureObject;
       glActiveTexture(GL_TEXTURE0 + textureBinding);
       glBindTexture(GL_TEXTURE_2D, textureObject);
       glUniform1i(location, textureBinding);
       textureBinding++;
     }
+    else if (const TextureLayer *layer = get_layer(property.value))
+    {
+      glActiveTexture(GL_TEXTURE0 + textureBinding);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, layer->array->textureObject);
+      glUniform1i(location, textureBinding);
+      textureBinding++;
+    }
   }
 }
 
+uvec4 Material::get_texture_layers() const
+{
+  uvec4 layers(0);
+  int i = 0;
+  for (const Property &property : properties)
+    if (const TextureLayer *layer = get_layer(property.value); layer && i < 4)
+      layers[i++] = layer->layer;
+  return layers;
+}
 
+bool Material::shares_bindings(const Material &other) const
+{
+  if (shader != other.shader || properties.size() != other.properties.size())
+    return false;
+  for (size_t i = 0; i < properties.size(); i++)
+  {
+    const Property &a = properties[i], &b = other.properties[i];
+    if (a.shaderUniformIdx != b.shaderUniformIdx)
+      return false;
+    const TextureLayer *layerA = get_layer(a.value), *layerB = get_layer(b.value);
+    if (layerA || layerB)
+    {
+      if (!layerA || !layerB || layerA->array != layerB->array)
+        return false;
+    }
+    else if (a.value != b.value)
+      return false;
+  }
+  return true;
+}
 
+uint64_t Material::binding_key() const
+{
+  const Shader *shaderPtr = shader.get();
+  uint64_t key = hash_bytes(&shaderPtr, sizeof(shaderPtr));
+  for (const Property &property : properties)
+  {
+    key = hash_bytes(&property.shaderUniformIdx, sizeof(property.shaderUniformIdx), key);
+    // same fields as shares_bindings compares, layers count only by their array
+    if (const TextureLayer *layer = get_layer(property.value))
+    {
+      const TextureArray *array = layer->array.get();
+      key = hash_bytes(&array, sizeof(array), key);
+      continue;
+    }
+    std::visit([&](const auto &value)
+    {
+      using T = std::decay_t<decltype(value)>;
+      if constexpr (std::is_same_v<T, float> || std::is_same_v<T, vec2> || std::is_same_v<T, vec3> || std::is_same_v<T, vec4>)
+        key = hash_bytes(&value, sizeof(T), key);
+      else
+      {
+        const void *object = value.get();
+        key = hash_bytes(&object, sizeof(object), key);
+      }
+    }, property.value);
+  }
+  return key;
+}
 
+void Material::request_texture_resolution(float screen_pixels) const
+{
+  for (const Property &property : properties)
+  {
+    if (const auto *v = std::get_if<Texture2DPtr>(&property.value))
+      ::request_texture_resolution(**v, screen_pixels);
+    else if (const auto *v = std::get_if<Texture2DHandle>(&property.value))
+      ::request_texture_resolution(*(*v)->get(), screen_pixels);
+  }
+}
@@ -4,6 +4,8 @@
 #include "log.h"
 #include "shader.h"
 #include "texture2d.h"
+#include "texture_array.h"
+#include "material_buffer.h"
 
 #define TYPES \
   TYPE(float, GL_FLOAT) TYPE(vec2, GL_FLOAT_VEC2) TYPE(vec3, GL_FLOAT_VEC3) TYPE(vec4, GL_FLOAT_VEC4) TYPE(Texture2DPtr, GL_SAMPLER_2D)\
@@ -13,44 +15,66 @@ class Material
 {
 private:
   ShaderPtr shader;
-  using MaterialProperty = std::variant<float, glm::vec2, glm::vec3, glm::vec4, Texture2DPtr>;
+  using MaterialProperty = std::variant<float, glm::vec2, glm::vec3, glm::vec4, Texture2DPtr, Texture2DHandle,
+    TextureLayerPtr, TextureLayerHandle>;
 
   struct Property
   {
-    std::string name;
-    int shaderUniformIdx;
+    UniformId id;
+    mutable int shaderUniformIdx; // -1 when a reloaded shader lost the uniform
     MaterialProperty value;
   };
   std::vector<Property> properties;
+  mutable int shaderGeneration = -1;
+
+  // scalar and vector properties packed as the shader's MaterialData block, uploaded only after a change
+  mutable std::vector<uint8_t> blockData;
+  mutable MaterialBlockSlot blockSlot;
+  mutable bool blockDirty = false;
+
+  // uniform indices change when the shader is reloaded, they are looked up again by id
+  void update_uniform_indices() const;
+  void write_block_property(const Property &property) const;
+
+  static const TextureLayer *get_layer(const MaterialProperty &value);
 
 public:
 
   Material(ShaderPtr &&shader) : shader(std::move(shader)) {}
+  Material(const Material &) = delete;
+  Material &operator=(const Material &) = delete;
+  ~Material();
 
   const Shader &get_shader() const { return *shader; }
   void bind_uniforms_to_shader() const;
+  // layers of the texture array properties in property order, they go to per instance data
+  uvec4 get_texture_layers() const;
+  // same shader and same bindings, texture layers only need the same array, such materials draw in one batch
+  bool shares_bindings(const Material &other) const;
+  // equal for materials that share bindings, sorting by it puts every such material next to each other
+  uint64_t binding_key() const;
+  // tells texture streaming the material is seen at about screen_pixels pixels across
+  void request_texture_resolution(float screen_pixels) const;
 
   template<typename T>
   bool set_property(const char *name, T &&value)
   {
+    const UniformId id = uniform_id(name);
     for (Property &p : properties)
     {
-      if (p.name == name)
+      if (p.id == id)
       {
         p.value = std::move(value);
+        write_block_property(p);
         return true;
       }
     }
 
-    int i = 0;
-    for (const ShaderUniform &sampler : shader->uniforms)
+    int i = shader->find_uniform(id);
+    if (i >= 0)
     {
-      if (sampler.name == name)
-      {
-        properties.emplace_back(Property{std::string(name), i, MaterialProperty{std::move(value)}});
-        return true;
-      }
-      i++;
+      write_block_property(properties.emplace_back(Property{id, i, MaterialProperty{std::move(value)}}));
+      return true;
     }
     debug_error("property %s in shader %s didn't found", name, shader->name.c_str());
     return false;
@@ -59,8 +83,14 @@ public:
 
 using MaterialPtr = std::shared_ptr<Material>;
 
-inline MaterialPtr make_material(const char *name, const char *vs_file, const char *ps_file)
+inline MaterialPtr make_material(const char *name, const char *vs_file, const char *ps_file, const ShaderDefines &defines = {})
+{
+  ShaderPtr shader = compile_shader(name, vs_file, ps_file, defines);
+  return shader ? std::make_shared<Material>(std::move(shader)) : nullptr;
+}
+
+inline MaterialPtr make_material(const char *name, const char *shader_file, const ShaderDefines &defines = {})
 {
-  ShaderPtr shader = compile_shader(name, vs_file, ps_file);
+  ShaderPtr shader = compile_shader(name, shader_file, defines);
   return shader ? std::make_shared<Material>(std::move(shader)) : nullptr;
 }
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "material_buffer.h"
+#include <algorithm>
+#include <map>
+#include "glad/glad.h"
+
+constexpr uint32_t InitialMaterialBufferSize = 64 << 10;
+
+static GLuint materialBuffer = 0;
+static uint32_t bufferSize = 0;
+static uint32_t usedSize = 0;
+static std::multimap<uint32_t, uint32_t> freeSlots; // aligned size -> offset
+
+static uint32_t aligned_size(uint32_t size)
+{
+  static const uint32_t alignment = []()
+  {
+    GLint value = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+    return (uint32_t)std::max(value, 16);
+  }();
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// old slots are copied on the gpu, so offsets stay valid
+static void grow(uint32_t size)
+{
+  GLuint buffer;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+  if (materialBuffer)
+  {
+    glBindBuffer(GL_COPY_READ_BUFFER, materialBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glDeleteBuffers(1, &materialBuffer);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  materialBuffer = buffer;
+  bufferSize = size;
+}
+
+MaterialBlockSlot allocate_material_block(uint32_t size)
+{
+  uint32_t alignedSize = aligned_size(size);
+  if (auto it = freeSlots.find(alignedSize); it != freeSlots.end())
+  {
+    MaterialBlockSlot slot{it->second, size};
+    freeSlots.erase(it);
+    return slot;
+  }
+  if (usedSize + alignedSize > bufferSize)
+    grow(std::max(usedSize + alignedSize, std::max(InitialMaterialBufferSize, bufferSize * 2)));
+  MaterialBlockSlot slot{usedSize, size};
+  usedSize += alignedSize;
+  return slot;
+}
+
+void free_material_block(MaterialBlockSlot slot)
+{
+  if (slot.size)
+    freeSlots.emplace(aligned_size(slot.size), slot.offset);
+}
+
+void update_material_block(MaterialBlockSlot slot, const void *data)
+{
+  glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+  glBufferSubData(GL_UNIFORM_BUFFER, slot.offset, slot.size, data);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void bind_material_block(MaterialBlockSlot slot)
+{
+  glBindBufferRange(GL_UNIFORM_BUFFER, MaterialDataBinding, materialBuffer, slot.offset, slot.size);
+}
+
+void release_material_buffer()
+{
+  glDeleteBuffers(1, &materialBuffer);
+  materialBuffer = 0;
+  bufferSize = usedSize = 0;
+  freeSlots.clear();
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+
+// std140 block with the scalar and vector properties of a material, see shaders/character_ps.glsl
+constexpr const char *MaterialDataBlock = "MaterialData";
+constexpr int MaterialDataBinding = 2;
+
+// part of the uniform buffer shared by all materials
+struct MaterialBlockSlot
+{
+  uint32_t offset = 0;
+  uint32_t size = 0; // 0 for no slot
+};
+
+MaterialBlockSlot allocate_material_block(uint32_t size);
+void free_material_block(MaterialBlockSlot slot);
+// only called when a material property changed, not every draw
+void update_material_block(MaterialBlockSlot slot, const void *data);
+void bind_material_block(MaterialBlockSlot slot);
+// deletes the buffer while the gl context is alive, every material has to be destroyed before
+void release_material_buffer();
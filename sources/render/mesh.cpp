@@ -1,169 +1,212 @@
 #include "mesh.h"
 #include <vector>
+#include <span>
 #include <3dmath.h>
-#include <assimp/scene.h>
-#include <assimp/Importer.hpp>
-#include <assimp/postprocess.h>
 #include <log.h>
+#include <task_queue.h>
+#include <resource_cache.h>
 #include "glad/glad.h"
+#include "mesh_data.h"
+#include "cooked_mesh.h"
+#include "mesh_import.h"
+#include "geometry_arena.h"
 
 
-static void create_indices(const std::vector<unsigned int> &indices)
+static void init_channel(int index, size_t offset, int component_count, GLenum type, bool normalized, bool is_integer)
 {
-  GLuint arrayIndexBuffer;
-  glGenBuffers(1, &arrayIndexBuffer);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arrayIndexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
-  glBindVertexArray(0);
-}
-
-static void init_channel(int index, size_t data_size, const void *data_ptr, int component_count, bool is_float)
-{
-  GLuint arrayBuffer;
-  glGenBuffers(1, &arrayBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, arrayBuffer);
-  glBufferData(GL_ARRAY_BUFFER, data_size, data_ptr, GL_STATIC_DRAW);
   glEnableVertexAttribArray(index);
-
-  if (is_float)
-    glVertexAttribPointer(index, component_count, GL_FLOAT, GL_FALSE, 0, 0);
+  if (is_integer)
+    glVertexAttribIFormat(index, component_count, type, offset);
   else
-    glVertexAttribIPointer(index, component_count, GL_UNSIGNED_INT, 0, 0);
+    glVertexAttribFormat(index, component_count, type, normalized, offset);
+  glVertexAttribBinding(index, 0);
 }
 
 
-template<int i>
+template<typename Format, int i>
 static void InitChannel() { }
 
-template<int i, typename T, typename... Channel>
-static void InitChannel(const std::vector<T> &channel, const Channel&... channels)
+template<typename Format, int i, typename T, typename... Channel>
+static void InitChannel()
 {
-  if (channel.size() > 0)
-  {
-    const int size = sizeof(T) / sizeof(channel[0][0]);
-    init_channel(i, sizeof(T) * channel.size(), channel.data(), size, !(std::is_same<T, uvec4>::value));
-  }
-  InitChannel<i + 1>(channels...);
+  using Traits = VertexChannel<T>;
+  init_channel(i, Format::offsets[i], Traits::components, Traits::type, Traits::normalized, Traits::integer);
+  InitChannel<Format, i + 1, Channel...>();
 }
 
 
 template<typename... Channel>
-MeshPtr create_mesh(const std::vector<unsigned int> &indices, const Channel&... channels)
+static void init_format(VertexFormat<Channel...>)
 {
-  uint32_t vertexArrayBufferObject;
-  glGenVertexArrays(1, &vertexArrayBufferObject);
-  glBindVertexArray(vertexArrayBufferObject);
-  InitChannel<0>(channels...);
-  create_indices(indices);
-  return std::make_shared<Mesh>(vertexArrayBufferObject, indices.size());
+  InitChannel<VertexFormat<Channel...>, 0, Channel...>();
 }
 
+// one arena per vertex format, attribute layout is fixed by the format at compile time
+static std::unique_ptr<GeometryArena> geometryArenas[(int)MeshVertexFormat::Count];
 
-MeshPtr create_mesh(const aiMesh *mesh)
+static GeometryArena &get_arena(MeshVertexFormat format)
 {
-  std::vector<uint32_t> indices;
-  std::vector<vec3> vertices;
-  std::vector<vec3> normals;
-  std::vector<vec2> uv;
-  std::vector<vec4> weights;
-  std::vector<uvec4> weightsIndex;
-
-  int numVert = mesh->mNumVertices;
-  int numFaces = mesh->mNumFaces;
-
-  if (mesh->HasFaces())
+  std::unique_ptr<GeometryArena> &arena = geometryArenas[(int)format];
+  if (!arena)
   {
-    indices.resize(numFaces * 3);
-    for (int i = 0; i < numFaces; i++)
+    void (*initFormat)();
+    switch (format)
     {
-      assert(mesh->mFaces[i].mNumIndices == 3);
-      for (int j = 0; j < 3; j++)
-        indices[i * 3 + j] = mesh->mFaces[i].mIndices[j];
+      case MeshVertexFormat::CompactSkinned8: initFormat = []() { init_format(CompactSkinnedVertex8()); }; break;
+      case MeshVertexFormat::CompactSkinned16: initFormat = []() { init_format(CompactSkinnedVertex16()); }; break;
+      case MeshVertexFormat::Static: initFormat = []() { init_format(StaticVertex()); }; break;
+      default: initFormat = []() { init_format(SkinnedVertex()); }; break;
     }
+    arena = std::make_unique<GeometryArena>(vertex_stride(format), initFormat);
   }
+  return *arena;
+}
 
-  if (mesh->HasPositions())
-  {
-    vertices.resize(numVert);
-    for (int i = 0; i < numVert; i++)
-      vertices[i] = to_vec3(mesh->mVertices[i]);
-  }
+static MeshPtr create_mesh(MeshVertexFormat format, std::span<const uint8_t> indices, uint32_t index_size,
+  std::span<const uint8_t> vertices, std::span<const MeshLod> lods, float bounding_radius)
+{
+  GeometryArena &arena = get_arena(format);
+  GeometryRange range = arena.allocate(vertices, indices, index_size);
+
+  GLenum indexType = index_size == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  std::vector<MeshLod> meshLods(lods.begin(), lods.end());
+  if (meshLods.empty())
+    meshLods.push_back(MeshLod{0, (uint32_t)(indices.size() / index_size), 0.f});
+  return std::make_shared<Mesh>(arena, indexType, range.baseVertex, range.vertexCount,
+    range.indexOffset, range.indexSize, std::move(meshLods), bounding_radius);
+}
 
-  if (mesh->HasNormals())
+void release_geometry_arenas()
+{
+  for (std::unique_ptr<GeometryArena> &arena : geometryArenas)
+    arena.reset();
+}
+
+Mesh::~Mesh()
+{
+  arena.free(GeometryRange{baseVertex, vertexCount, indexOffset, indexBytes});
+}
+
+MeshPtr create_mesh(const MeshData &data, bool compact_vertices)
+{
+  uint32_t indexSize;
+  std::vector<uint8_t> indices = pack_indices(data, indexSize);
+  MeshVertexFormat format = choose_vertex_format(data, compact_vertices);
+  return create_mesh(format, indices, indexSize, interleave_vertices(data, format), data.lods, bounding_radius(data));
+}
+
+// blobs are handed from the mapping straight to glBufferData
+static MeshPtr create_mesh(const CookedMesh &cooked)
+{
+  return create_mesh(cooked.header->vertexFormat,
+    cooked.channel<uint8_t>(CookedMeshChannel::Indices),
+    cooked.header->indexSize,
+    cooked.channel<uint8_t>(CookedMeshChannel::Vertices),
+    cooked.channel<MeshLod>(CookedMeshChannel::Lods),
+    cooked.header->boundingRadius);
+}
+
+
+// cooked data when it's up to date, freshly imported mesh otherwise
+struct MeshSource
+{
+  CookedMeshPtr cooked;
+  MeshData imported;
+};
+
+// file io and import only, safe on any thread
+static bool read_mesh(const char *path, int idx, bool compact_vertices, MeshSource &source)
+{
+  std::string cookedPath = cooked_mesh_path(path, idx);
+  if ((source.cooked = open_cooked_mesh(cookedPath.c_str(), path, mesh_cook_settings(compact_vertices))))
+    return true;
+
+  std::vector<MeshData> meshes;
+  ModelData model;
+  if (!cook_model(path, compact_vertices, meshes, model))
+    return false;
+  if (idx < 0 || idx >= (int)meshes.size())
   {
-    normals.resize(numVert);
-    for (int i = 0; i < numVert; i++)
-      normals[i] = to_vec3(mesh->mNormals[i]);
+    debug_error("no mesh #%d in %s", idx, path);
+    return false;
   }
+  source.imported = std::move(meshes[idx]);
+  return true;
+}
+
+static MeshPtr create_mesh(const MeshSource &source, bool compact_vertices)
+{
+  return source.cooked ? create_mesh(*source.cooked) : create_mesh(source.imported, compact_vertices);
+}
+
+static AsyncResourceCache<Mesh> meshCache("mesh");
 
-  if (mesh->HasTextureCoords(0))
+static std::string mesh_cache_key(const char *path, int idx, bool compact_vertices)
+{
+  return std::string(path) + "#" + std::to_string(idx) + (compact_vertices ? "#compact" : "#full");
+}
+
+MeshPtr load_mesh(const char *path, int idx, bool compact_vertices)
+{
+  return meshCache.get_or_load(mesh_cache_key(path, idx, compact_vertices), [&]() -> MeshPtr
   {
-    uv.resize(numVert);
-    for (int i = 0; i < numVert; i++)
-      uv[i] = to_vec2(mesh->mTextureCoords[0][i]);
-  }
+    MeshSource source;
+    if (!read_mesh(path, idx, compact_vertices, source))
+      return nullptr;
+    return create_mesh(source, compact_vertices);
+  });
+}
 
-  if (mesh->HasBones())
+MeshHandle load_mesh_async(const char *path, int idx, bool compact_vertices)
+{
+  std::string key = mesh_cache_key(path, idx, compact_vertices);
+  return meshCache.get_or_start(key, nullptr, [&]()
   {
-    weights.resize(numVert, vec4(0.f));
-    weightsIndex.resize(numVert);
-    int numBones = mesh->mNumBones;
-    std::vector<int> weightsOffset(numVert, 0);
-    for (int i = 0; i < numBones; i++)
+    run_async([key, path = std::string(path), idx, compact_vertices]()
     {
-      const aiBone *bone = mesh->mBones[i];
-      //bonesMap[std::string(bone->mName.C_Str())] = i;
-
-      for (unsigned j = 0; j < bone->mNumWeights; j++)
+      auto source = std::make_shared<MeshSource>();
+      if (!read_mesh(path.c_str(), idx, compact_vertices, *source))
       {
-        int vertex = bone->mWeights[j].mVertexId;
-        int offset = weightsOffset[vertex]++;
-        weights[vertex][offset] = bone->mWeights[j].mWeight;
-        weightsIndex[vertex][offset] = i;
+        run_on_main_thread([key]() { meshCache.finish(key, nullptr); });
+        return;
       }
-    }
-    //the sum of weights not 1
-    for (int i = 0; i < numVert; i++)
-    {
-      vec4 w = weights[i];
-      float s = w.x + w.y + w.z + w.w;
-      weights[i] *= 1.f / s;
-    }
-  }
-  return create_mesh(indices, vertices, normals, uv, weights, weightsIndex);
+      run_on_main_thread([key, source, compact_vertices]() { meshCache.finish(key, create_mesh(*source, compact_vertices)); });
+    });
+  });
 }
 
-MeshPtr load_mesh(const char *path, int idx)
+int select_lod(const Mesh &mesh, float pixels_per_unit, float max_pixel_error)
 {
+  int lod = 0;
+  while (lod + 1 < (int)mesh.lods.size() && mesh.lods[lod + 1].error * pixels_per_unit <= max_pixel_error)
+    lod++;
+  return lod;
+}
 
-  Assimp::Importer importer;
-  importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);
-  importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, 1.f);
-
-  importer.ReadFile(path, aiPostProcessSteps::aiProcess_Triangulate | aiPostProcessSteps::aiProcess_LimitBoneWeights |
-    aiPostProcessSteps::aiProcess_GenNormals | aiProcess_GlobalScale | aiProcess_FlipWindingOrder);
-
-  const aiScene* scene = importer.GetScene();
-  if (!scene)
-  {
-    debug_error("no asset in %s", path);
-    return nullptr;
-  }
-
-  return create_mesh(scene->mMeshes[idx]);
+void render(const MeshPtr &mesh, int lod)
+{
+  const MeshLod &range = mesh->lods[lod];
+  const size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+  mesh->arena.bind();
+  glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, mesh->indexType,
+    (const void *)(mesh->indexOffset + range.firstIndex * indexSize), mesh->baseVertex);
 }
 
-void render(const MeshPtr &mesh)
+void render_instanced(const MeshPtr &mesh, int lod, int instance_count)
 {
-  glBindVertexArray(mesh->vertexArrayBufferObject);
-  glDrawElementsBaseVertex(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0, 0);
+  const MeshLod &range = mesh->lods[lod];
+  const size_t indexSize = mesh->indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t);
+  mesh->arena.bind();
+  glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, mesh->indexType,
+    (const void *)(mesh->indexOffset + range.firstIndex * indexSize), instance_count, mesh->baseVertex);
 }
 
 MeshPtr make_plane_mesh()
 {
-  std::vector<uint32_t> indices = {0,1,2,0,2,3};
+  std::vector<uint16_t> indices = {0,1,2,0,2,3};
   std::vector<vec3> vertices = {vec3(-1,0,-1), vec3(1,0,-1), vec3(1,0,1), vec3(-1,0,1)};
   std::vector<vec3> normals(4, vec3(0,1,0));
   std::vector<vec2> uv = {vec2(0,0), vec2(1,0), vec2(1,1), vec2(0,1)};
-  return create_mesh(indices, vertices, normals, uv);
+  return create_mesh(MeshVertexFormat::Static, as_blob(indices), sizeof(uint16_t),
+    interleave_vertices<vec3, vec3, vec2>(StaticVertex(), vertices.size(), vertices, normals, uv), {}, sqrt(2.f));
 }
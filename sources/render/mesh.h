@@ -1,22 +1,65 @@
 #pragma once
 #include <map>
 #include <memory>
+#include <vector>
+#include <async_resource.h>
 
+// range of the shared index buffer, error is the simplification error in model units
+struct MeshLod
+{
+  uint32_t firstIndex;
+  uint32_t indexCount;
+  float error;
+};
 
+class GeometryArena;
+struct MeshData;
+
+// suballocated range of the arena of the mesh's vertex format
 struct Mesh
 {
-  const uint32_t vertexArrayBufferObject;
+  GeometryArena &arena;
   const int numIndices;
+  const uint32_t indexType;
+  const uint32_t baseVertex;
+  const uint32_t vertexCount;
+  const uint64_t indexOffset; // bytes
+  const uint64_t indexBytes;
+  const std::vector<MeshLod> lods; // lods[0] is the full mesh, firstIndex is relative to indexOffset
+  const float boundingRadius; // around the model origin
 
-  Mesh(uint32_t vertexArrayBufferObject, int numIndices) :
-    vertexArrayBufferObject(vertexArrayBufferObject),
-    numIndices(numIndices)
+  Mesh(GeometryArena &arena, uint32_t indexType, uint32_t baseVertex, uint32_t vertexCount,
+    uint64_t indexOffset, uint64_t indexBytes, std::vector<MeshLod> lods, float boundingRadius) :
+    arena(arena),
+    numIndices(lods[0].indexCount),
+    indexType(indexType),
+    baseVertex(baseVertex),
+    vertexCount(vertexCount),
+    indexOffset(indexOffset),
+    indexBytes(indexBytes),
+    lods(std::move(lods)),
+    boundingRadius(boundingRadius)
     {}
+  Mesh(const Mesh &) = delete;
+  ~Mesh();
 };
 
 using MeshPtr = std::shared_ptr<Mesh>;
+using MeshHandle = AsyncResourcePtr<Mesh>;
 
-MeshPtr load_mesh(const char *path, int idx);
+// compact_vertices packs normals, uv, weights and bone indices into 28-32 bytes per vertex
+MeshPtr load_mesh(const char *path, int idx, bool compact_vertices = true);
+// parses or cooks on a worker thread, the handle resolves to null until the mesh is uploaded
+MeshHandle load_mesh_async(const char *path, int idx, bool compact_vertices = true);
+MeshPtr create_mesh(const MeshData &data, bool compact_vertices);
 MeshPtr make_plane_mesh();
+// frees the shared vertex and index buffers while the gl context is alive, every mesh has to be destroyed before
+void release_geometry_arenas();
+
+// coarsest lod whose error projects to no more than max_pixel_error pixels
+// pixels_per_unit is how many pixels one model unit covers at the mesh's distance
+int select_lod(const Mesh &mesh, float pixels_per_unit, float max_pixel_error = 1.f);
 
-void render(const MeshPtr &mesh);
\ No newline at end of file
+void render(const MeshPtr &mesh, int lod = 0);
+// per instance data comes from buffers the caller binds, gl_InstanceID indexes it
+void render_instanced(const MeshPtr &mesh, int lod, int instance_count);
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "mesh_data.h"
+#include <glm/gtc/packing.hpp>
+
+MeshVertexFormat choose_vertex_format(const MeshData &mesh, bool compact)
+{
+  if (!compact)
+    return MeshVertexFormat::Skinned;
+  unsigned maxBone = 0;
+  for (const uvec4 &index : mesh.weightsIndex)
+    maxBone = max(maxBone, max(max(index.x, index.y), max(index.z, index.w)));
+  return maxBone < 256 ? MeshVertexFormat::CompactSkinned8 : MeshVertexFormat::CompactSkinned16;
+}
+
+static PackedWeights pack_weights(const vec4 &w)
+{
+  PackedWeights packed;
+  int sum = 0, largest = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    packed.w[i] = (uint8_t)glm::clamp(glm::round(w[i] * 255.f), 0.f, 255.f);
+    sum += packed.w[i];
+    if (w[i] > w[largest])
+      largest = i;
+  }
+  // rounding error goes to the largest influence, so the weights still sum to 1
+  if (sum > 0)
+    packed.w[largest] += 255 - sum;
+  return packed;
+}
+
+template<typename BoneIndex>
+static std::vector<uint8_t> interleave_compact(const MeshData &mesh)
+{
+  using Format = VertexFormat<vec3, PackedNormal, HalfUV, PackedWeights, BoneIndex>;
+  const size_t vertexCount = mesh.vertices.size();
+  std::vector<PackedNormal> normals(mesh.normals.size());
+  std::vector<HalfUV> uv(mesh.uv.size());
+  std::vector<PackedWeights> weights(mesh.weights.size());
+  std::vector<BoneIndex> weightsIndex(mesh.weightsIndex.size());
+
+  for (size_t i = 0; i < normals.size(); i++)
+    normals[i].xyzw = packSnorm3x10_1x2(vec4(mesh.normals[i], 0.f));
+  for (size_t i = 0; i < uv.size(); i++)
+    uv[i].xy = packHalf2x16(mesh.uv[i]);
+  for (size_t i = 0; i < weights.size(); i++)
+    weights[i] = pack_weights(mesh.weights[i]);
+  for (size_t i = 0; i < weightsIndex.size(); i++)
+    for (int j = 0; j < 4; j++)
+      weightsIndex[i].i[j] = mesh.weightsIndex[i][j];
+
+  return interleave_vertices<vec3, PackedNormal, HalfUV, PackedWeights, BoneIndex>(Format(), vertexCount,
+    mesh.vertices, normals, uv, weights, weightsIndex);
+}
+
+std::vector<uint8_t> interleave_vertices(const MeshData &mesh, MeshVertexFormat format)
+{
+  switch (format)
+  {
+    case MeshVertexFormat::CompactSkinned8: return interleave_compact<BoneIndex8>(mesh);
+    case MeshVertexFormat::CompactSkinned16: return interleave_compact<BoneIndex16>(mesh);
+    default:
+      return interleave_vertices<vec3, vec3, vec2, vec4, uvec4>(SkinnedVertex(), mesh.vertices.size(),
+        mesh.vertices, mesh.normals, mesh.uv, mesh.weights, mesh.weightsIndex);
+  }
+}
+
+std::vector<uint8_t> pack_indices(const MeshData &mesh, uint32_t &index_size)
+{
+  if (mesh.vertices.size() >= 65536)
+  {
+    index_size = sizeof(uint32_t);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(mesh.indices.data());
+    return std::vector<uint8_t>(bytes, bytes + mesh.indices.size() * sizeof(uint32_t));
+  }
+  index_size = sizeof(uint16_t);
+  std::vector<uint8_t> packed(mesh.indices.size() * sizeof(uint16_t));
+  uint16_t *dst = reinterpret_cast<uint16_t *>(packed.data());
+  for (size_t i = 0; i < mesh.indices.size(); i++)
+    dst[i] = mesh.indices[i];
+  return packed;
+}
+
+float bounding_radius(const MeshData &mesh)
+{
+  float radius = 0.f;
+  for (const vec3 &v : mesh.vertices)
+    radius = max(radius, length(v));
+  return radius;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <3dmath.h>
+#include "vertex_format.h"
+#include "mesh.h"
+
+// cpu side copy of mesh streams, one vector per vertex attribute
+// indices hold every lod back to back, empty lods means a single lod over all indices
+struct MeshData
+{
+  std::vector<uint32_t> indices;
+  std::vector<MeshLod> lods;
+  std::vector<vec3> vertices;
+  std::vector<vec3> normals;
+  std::vector<vec2> uv;
+  std::vector<vec4> weights;
+  std::vector<uvec4> weightsIndex;
+};
+
+// compact formats take 28 or 32 bytes per vertex instead of 64, bone index width follows the bone count
+MeshVertexFormat choose_vertex_format(const MeshData &mesh, bool compact);
+
+std::vector<uint8_t> interleave_vertices(const MeshData &mesh, MeshVertexFormat format);
+
+// distance from the model origin to the farthest vertex
+float bounding_radius(const MeshData &mesh);
+
+// 16 bit indices whenever the vertex count allows it
+std::vector<uint8_t> pack_indices(const MeshData &mesh, uint32_t &index_size);
@@ -0,0 +1,206 @@
+#include "mesh_import.h"
+#include <assimp/scene.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <log.h>
+#include <map>
+#include "cooked_mesh.h"
+#include "cooked_model.h"
+#include "mesh_optimizer.h"
+#include "mesh_lod.h"
+
+const unsigned MeshImportFlags = aiPostProcessSteps::aiProcess_Triangulate | aiPostProcessSteps::aiProcess_LimitBoneWeights |
+    aiPostProcessSteps::aiProcess_GenNormals | aiProcess_GlobalScale | aiProcess_FlipWindingOrder;
+
+static mat4 to_mat4(const aiMatrix4x4 &m)
+{
+  // assimp matrices are row major
+  return transpose(make_mat4(&m.a1));
+}
+
+static MeshData import_mesh(const aiMesh *mesh, const std::vector<uint32_t> &bone_remap)
+{
+  MeshData data;
+  std::vector<uint32_t> &indices = data.indices;
+  std::vector<vec3> &vertices = data.vertices;
+  std::vector<vec3> &normals = data.normals;
+  std::vector<vec2> &uv = data.uv;
+  std::vector<vec4> &weights = data.weights;
+  std::vector<uvec4> &weightsIndex = data.weightsIndex;
+
+  int numVert = mesh->mNumVertices;
+  int numFaces = mesh->mNumFaces;
+
+  if (mesh->HasFaces())
+  {
+    indices.resize(numFaces * 3);
+    for (int i = 0; i < numFaces; i++)
+    {
+      assert(mesh->mFaces[i].mNumIndices == 3);
+      for (int j = 0; j < 3; j++)
+        indices[i * 3 + j] = mesh->mFaces[i].mIndices[j];
+    }
+  }
+
+  if (mesh->HasPositions())
+  {
+    vertices.resize(numVert);
+    for (int i = 0; i < numVert; i++)
+      vertices[i] = to_vec3(mesh->mVertices[i]);
+  }
+
+  if (mesh->HasNormals())
+  {
+    normals.resize(numVert);
+    for (int i = 0; i < numVert; i++)
+      normals[i] = to_vec3(mesh->mNormals[i]);
+  }
+
+  if (mesh->HasTextureCoords(0))
+  {
+    uv.resize(numVert);
+    for (int i = 0; i < numVert; i++)
+      uv[i] = to_vec2(mesh->mTextureCoords[0][i]);
+  }
+
+  if (mesh->HasBones())
+  {
+    weights.resize(numVert, vec4(0.f));
+    weightsIndex.resize(numVert);
+    int numBones = mesh->mNumBones;
+    std::vector<int> weightsOffset(numVert, 0);
+    for (int i = 0; i < numBones; i++)
+    {
+      const aiBone *bone = mesh->mBones[i];
+
+      for (unsigned j = 0; j < bone->mNumWeights; j++)
+      {
+        int vertex = bone->mWeights[j].mVertexId;
+        int offset = weightsOffset[vertex]++;
+        weights[vertex][offset] = bone->mWeights[j].mWeight;
+        weightsIndex[vertex][offset] = bone_remap[i];
+      }
+    }
+    //the sum of weights not 1
+    for (int i = 0; i < numVert; i++)
+    {
+      vec4 w = weights[i];
+      float s = w.x + w.y + w.z + w.w;
+      weights[i] *= 1.f / s;
+    }
+  }
+  return data;
+}
+
+static void import_nodes(const aiNode *node, int parent, ModelData &model)
+{
+  int index = model.nodes.size();
+  std::vector<uint32_t> meshes(node->mMeshes, node->mMeshes + node->mNumMeshes);
+  model.nodes.push_back(ModelNode{node->mName.C_Str(), parent, to_mat4(node->mTransformation), std::move(meshes)});
+  for (unsigned i = 0; i < node->mNumChildren; i++)
+    import_nodes(node->mChildren[i], index, model);
+}
+
+// bones are merged by name, so every submesh indexes the same bone table
+static std::vector<std::vector<uint32_t>> import_bones(const aiScene *scene, ModelData &model)
+{
+  std::map<std::string, uint32_t> boneIndex;
+  std::map<std::string, int> nodeIndex;
+  for (size_t i = 0; i < model.nodes.size(); i++)
+    nodeIndex.emplace(model.nodes[i].name, i);
+
+  std::vector<std::vector<uint32_t>> remap(scene->mNumMeshes);
+  for (unsigned i = 0; i < scene->mNumMeshes; i++)
+  {
+    const aiMesh *mesh = scene->mMeshes[i];
+    for (unsigned j = 0; j < mesh->mNumBones; j++)
+    {
+      const aiBone *bone = mesh->mBones[j];
+      std::string name = bone->mName.C_Str();
+      auto [it, inserted] = boneIndex.emplace(name, model.bones.size());
+      if (inserted)
+      {
+        auto node = nodeIndex.find(name);
+        model.bones.push_back(ModelBone{name, node != nodeIndex.end() ? node->second : -1, to_mat4(bone->mOffsetMatrix)});
+      }
+      remap[i].push_back(it->second);
+    }
+  }
+  return remap;
+}
+
+static void import_materials(const aiScene *scene, ModelData &model)
+{
+  model.materials.resize(scene->mNumMaterials);
+  for (unsigned i = 0; i < scene->mNumMaterials; i++)
+  {
+    const aiMaterial *material = scene->mMaterials[i];
+    aiString name, texture;
+    if (material->Get(AI_MATKEY_NAME, name) == aiReturn_SUCCESS)
+      model.materials[i].name = name.C_Str();
+    if (material->GetTexture(aiTextureType_DIFFUSE, 0, &texture) == aiReturn_SUCCESS)
+      model.materials[i].diffuseTexture = texture.C_Str();
+  }
+  model.meshMaterials.resize(scene->mNumMeshes);
+  for (unsigned i = 0; i < scene->mNumMeshes; i++)
+    model.meshMaterials[i] = scene->mMeshes[i]->mMaterialIndex;
+}
+
+bool import_model(const char *path, std::vector<MeshData> &meshes, ModelData &model)
+{
+  Assimp::Importer importer;
+  importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, false);
+  importer.SetPropertyFloat(AI_CONFIG_GLOBAL_SCALE_FACTOR_KEY, 1.f);
+
+  importer.ReadFile(path, MeshImportFlags);
+
+  const aiScene* scene = importer.GetScene();
+  if (!scene)
+  {
+    debug_error("no asset in %s", path);
+    return false;
+  }
+
+  model = ModelData();
+  if (scene->mRootNode)
+    import_nodes(scene->mRootNode, -1, model);
+  import_materials(scene, model);
+  std::vector<std::vector<uint32_t>> boneRemap = import_bones(scene, model);
+
+  meshes.resize(scene->mNumMeshes);
+  for (unsigned i = 0; i < scene->mNumMeshes; i++)
+  {
+    meshes[i] = import_mesh(scene->mMeshes[i], boneRemap[i]);
+    MeshOptimizationStats stats = optimize_mesh(meshes[i]);
+    debug_log("%s #%u: %u -> %u vertices, ACMR %.3f -> %.3f", path, i,
+      stats.verticesBefore, stats.verticesAfter, stats.acmrBefore, stats.acmrAfter);
+    generate_lods(meshes[i]);
+    debug_log("%s #%u: %zu lods", path, i, meshes[i].lods.size());
+  }
+  return true;
+}
+
+uint64_t mesh_cook_settings(bool compact_vertices)
+{
+  return (uint64_t)compact_vertices << 32 | MeshImportFlags;
+}
+
+bool cook_model(const char *path, bool compact_vertices, std::vector<MeshData> &meshes, ModelData &model)
+{
+  SourceStamp source;
+  if (!make_source_stamp(path, source) || !import_model(path, meshes, model))
+    return false;
+
+  const uint64_t settings = mesh_cook_settings(compact_vertices);
+  for (size_t i = 0; i < meshes.size(); i++)
+  {
+    std::string cookedPath = cooked_mesh_path(path, i);
+    MeshVertexFormat format = choose_vertex_format(meshes[i], compact_vertices);
+    if (!save_cooked_mesh(cookedPath.c_str(), source, settings, meshes.size(), format, meshes[i]))
+      debug_error("can't cook %s", cookedPath.c_str());
+  }
+  std::string cookedPath = cooked_model_path(path);
+  if (!save_cooked_model(cookedPath.c_str(), source, settings, meshes.size(), model))
+    debug_error("can't cook %s", cookedPath.c_str());
+  return true;
+}
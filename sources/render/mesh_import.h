@@ -0,0 +1,15 @@
+#pragma once
+#include <vector>
+#include "mesh_data.h"
+#include "model_data.h"
+
+extern const unsigned MeshImportFlags;
+
+// what a cooked mesh depends on: assimp flags in the low half, vertex format options in the high half
+uint64_t mesh_cook_settings(bool compact_vertices);
+
+// imports every mesh, the node hierarchy, materials and the merged bone table in one importer pass
+bool import_model(const char *path, std::vector<MeshData> &meshes, ModelData &model);
+
+// imports the file and writes <path>.model and <path>.<idx>.mesh for each of its meshes
+bool cook_model(const char *path, bool compact_vertices, std::vector<MeshData> &meshes, ModelData &model);
@@ -0,0 +1,293 @@
+#include "mesh_lod.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+#include "mesh_optimizer.h"
+
+// l1 distance of two skin weight sets (0..2), collapses across larger differences would break deformation
+constexpr float SkinWeightTolerance = 0.3f;
+constexpr uint32_t MinLodTriangles = 64;
+// stop the chain when simplification can't remove at least this part of the triangles
+constexpr float MinLodProgress = 0.9f;
+
+struct Quadric
+{
+  // symmetric 4x4 matrix: xx xy xz xw yy yz yw zz zw ww
+  double m[10] = {};
+  double weight = 0.0;
+
+  void add_plane(const vec3 &n, float d, double weight)
+  {
+    double a = n.x, b = n.y, c = n.z, w = d;
+    double v[10] = {a * a, a * b, a * c, a * w, b * b, b * c, b * w, c * c, c * w, w * w};
+    for (int i = 0; i < 10; i++)
+      m[i] += v[i] * weight;
+    this->weight += weight;
+  }
+  Quadric &operator+=(const Quadric &q)
+  {
+    for (int i = 0; i < 10; i++)
+      m[i] += q.m[i];
+    weight += q.weight;
+    return *this;
+  }
+  // area weighted mean of squared distances to the planes
+  double error(const vec3 &p) const
+  {
+    double x = p.x, y = p.y, z = p.z;
+    double e = m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+      + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+      + m[7] * z * z + 2 * m[8] * z
+      + m[9];
+    return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+  }
+};
+
+struct Collapse
+{
+  double cost;
+  uint32_t from, to;
+  uint32_t fromVersion, toVersion;
+
+  bool operator<(const Collapse &c) const { return cost > c.cost; }
+};
+
+// what can't change between lods: which vertices may move and which pairs may merge
+struct LodContext
+{
+  const MeshData &mesh;
+  std::vector<bool> locked;
+
+  float bone_weight(uint32_t v, uint32_t bone) const
+  {
+    float w = 0.f;
+    for (int i = 0; i < 4; i++)
+      if (mesh.weightsIndex[v][i] == bone)
+        w += mesh.weights[v][i];
+    return w;
+  }
+
+  bool skin_compatible(uint32_t a, uint32_t b) const
+  {
+    if (mesh.weights.empty())
+      return true;
+    // unused slots have zero weight and an arbitrary bone, skip them
+    float distance = 0.f;
+    for (int i = 0; i < 4; i++)
+    {
+      if (mesh.weights[a][i] > 0.f)
+        distance += std::abs(mesh.weights[a][i] - bone_weight(b, mesh.weightsIndex[a][i]));
+      if (mesh.weights[b][i] > 0.f && bone_weight(a, mesh.weightsIndex[b][i]) == 0.f)
+        distance += mesh.weights[b][i];
+    }
+    return distance <= SkinWeightTolerance;
+  }
+};
+
+// border vertices and uv/normal seams (one position, several vertices) are locked,
+// so silhouettes and texture layout survive and seam wedges never drift apart
+static LodContext make_lod_context(const MeshData &mesh)
+{
+  LodContext context{mesh, std::vector<bool>(mesh.vertices.size(), false)};
+  const uint32_t vertexCount = mesh.vertices.size();
+
+  struct PositionHash
+  {
+    size_t operator()(const vec3 &p) const
+    {
+      return std::hash<float>()(p.x) ^ (std::hash<float>()(p.y) * 31) ^ (std::hash<float>()(p.z) * 131);
+    }
+  };
+  std::unordered_map<vec3, uint32_t, PositionHash> positions;
+  std::vector<uint32_t> positionId(vertexCount);
+  std::vector<uint32_t> wedgeCount;
+  for (uint32_t v = 0; v < vertexCount; v++)
+  {
+    auto [it, inserted] = positions.emplace(mesh.vertices[v], wedgeCount.size());
+    if (inserted)
+      wedgeCount.push_back(0);
+    positionId[v] = it->second;
+    wedgeCount[it->second]++;
+  }
+  for (uint32_t v = 0; v < vertexCount; v++)
+    if (wedgeCount[positionId[v]] > 1)
+      context.locked[v] = true;
+
+  // edges are counted on positions, so seams don't look like borders
+  std::unordered_map<uint64_t, int> edges;
+  auto edge_key = [&](uint32_t a, uint32_t b)
+  {
+    uint64_t pa = positionId[a], pb = positionId[b];
+    return pa < pb ? pa << 32 | pb : pb << 32 | pa;
+  };
+  const uint32_t indexCount = mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount;
+  for (uint32_t i = 0; i < indexCount; i += 3)
+    for (int j = 0; j < 3; j++)
+      edges[edge_key(mesh.indices[i + j], mesh.indices[i + (j + 1) % 3])]++;
+  for (uint32_t i = 0; i < indexCount; i += 3)
+    for (int j = 0; j < 3; j++)
+    {
+      uint32_t a = mesh.indices[i + j], b = mesh.indices[i + (j + 1) % 3];
+      if (edges[edge_key(a, b)] != 2)
+        context.locked[a] = context.locked[b] = true;
+    }
+  return context;
+}
+
+static vec3 triangle_normal(const vec3 &a, const vec3 &b, const vec3 &c)
+{
+  return cross(b - a, c - a);
+}
+
+// quadric error metric edge collapse (Garland, Heckbert) onto existing vertices,
+// the surviving vertex keeps its own attributes and skin weights
+static std::vector<uint32_t> simplify(const LodContext &context, const std::vector<uint32_t> &indices,
+  uint32_t target_triangles, float &error)
+{
+  const std::vector<vec3> &positions = context.mesh.vertices;
+  const uint32_t vertexCount = positions.size();
+  std::vector<uint32_t> triangles = indices;
+  uint32_t triangleCount = triangles.size() / 3;
+  std::vector<bool> triangleAlive(triangleCount, true);
+
+  std::vector<Quadric> quadrics(vertexCount);
+  std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+  for (uint32_t t = 0; t < triangleCount; t++)
+  {
+    const vec3 &a = positions[triangles[t * 3]], &b = positions[triangles[t * 3 + 1]], &c = positions[triangles[t * 3 + 2]];
+    vec3 n = triangle_normal(a, b, c);
+    float area = length(n);
+    if (area > 0.f)
+    {
+      n /= area;
+      Quadric q;
+      q.add_plane(n, -dot(n, a), area * 0.5);
+      for (int j = 0; j < 3; j++)
+        quadrics[triangles[t * 3 + j]] += q;
+    }
+    for (int j = 0; j < 3; j++)
+      vertexTriangles[triangles[t * 3 + j]].push_back(t);
+  }
+
+  std::vector<uint32_t> version(vertexCount, 0);
+  std::vector<bool> removed(vertexCount, false);
+  std::priority_queue<Collapse> queue;
+  auto push = [&](uint32_t from, uint32_t to)
+  {
+    if (!context.locked[from] && context.skin_compatible(from, to))
+      queue.push(Collapse{quadrics[from].error(positions[to]), from, to, version[from], version[to]});
+  };
+  for (uint32_t t = 0; t < triangleCount; t++)
+    for (int j = 0; j < 3; j++)
+    {
+      push(triangles[t * 3 + j], triangles[t * 3 + (j + 1) % 3]);
+      push(triangles[t * 3 + (j + 1) % 3], triangles[t * 3 + j]);
+    }
+
+  double maxCost = 0.0;
+  while (triangleCount > target_triangles && !queue.empty())
+  {
+    Collapse c = queue.top();
+    queue.pop();
+    if (removed[c.from] || removed[c.to] || version[c.from] != c.fromVersion || version[c.to] != c.toVersion)
+      continue;
+
+    // reject collapses that flip a remaining triangle
+    bool flips = false;
+    for (uint32_t t : vertexTriangles[c.from])
+    {
+      if (!triangleAlive[t])
+        continue;
+      uint32_t *tri = &triangles[t * 3];
+      if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+        continue;
+      vec3 p[3], q[3];
+      for (int j = 0; j < 3; j++)
+      {
+        p[j] = positions[tri[j]];
+        q[j] = tri[j] == c.from ? positions[c.to] : p[j];
+      }
+      vec3 before = triangle_normal(p[0], p[1], p[2]), after = triangle_normal(q[0], q[1], q[2]);
+      if (dot(before, after) <= 0.f)
+      {
+        flips = true;
+        break;
+      }
+    }
+    if (flips)
+      continue;
+
+    for (uint32_t t : vertexTriangles[c.from])
+    {
+      if (!triangleAlive[t])
+        continue;
+      uint32_t *tri = &triangles[t * 3];
+      if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+      {
+        triangleAlive[t] = false;
+        triangleCount--;
+        continue;
+      }
+      for (int j = 0; j < 3; j++)
+        if (tri[j] == c.from)
+          tri[j] = c.to;
+      vertexTriangles[c.to].push_back(t);
+    }
+    removed[c.from] = true;
+    quadrics[c.to] += quadrics[c.from];
+    version[c.to]++;
+    maxCost = std::max(maxCost, c.cost);
+
+    std::vector<uint32_t> &around = vertexTriangles[c.to];
+    around.erase(std::remove_if(around.begin(), around.end(), [&](uint32_t t) { return !triangleAlive[t]; }), around.end());
+    for (uint32_t t : around)
+      for (int j = 0; j < 3; j++)
+      {
+        uint32_t w = triangles[t * 3 + j];
+        if (w != c.to)
+        {
+          push(c.to, w);
+          push(w, c.to);
+        }
+      }
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount * 3);
+  for (uint32_t t = 0; t < triangleAlive.size(); t++)
+    if (triangleAlive[t])
+      result.insert(result.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+  error = std::sqrt((float)maxCost);
+  return result;
+}
+
+void generate_lods(MeshData &mesh, int max_lods, float reduction)
+{
+  mesh.lods.assign(1, MeshLod{0, (uint32_t)mesh.indices.size(), 0.f});
+  if (mesh.indices.empty())
+    return;
+
+  LodContext context = make_lod_context(mesh);
+  std::vector<uint32_t> previous = mesh.indices;
+  float previousError = 0.f;
+  for (int lod = 1; lod < max_lods; lod++)
+  {
+    uint32_t previousTriangles = previous.size() / 3;
+    uint32_t target = previousTriangles * reduction;
+    if (target < MinLodTriangles)
+      break;
+
+    float error;
+    std::vector<uint32_t> indices = simplify(context, previous, target, error);
+    if (indices.size() / 3 > previousTriangles * MinLodProgress)
+      break;
+
+    // each lod is simplified from the previous one, so errors add up
+    previousError += error;
+    indices = optimize_vertex_cache(indices, mesh.vertices.size());
+    mesh.lods.push_back(MeshLod{(uint32_t)mesh.indices.size(), (uint32_t)indices.size(), previousError});
+    mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+    previous = std::move(indices);
+  }
+}
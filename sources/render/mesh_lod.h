@@ -0,0 +1,6 @@
+#pragma once
+#include "mesh_data.h"
+
+// appends simplified copies of the full mesh to mesh.indices and describes every lod in mesh.lods,
+// all lods share the vertex buffer, so run it after optimize_mesh
+void generate_lods(MeshData &mesh, int max_lods = 4, float reduction = 0.5f);
@@ -0,0 +1,332 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+constexpr int FifoCacheSize = 16;
+constexpr int ForsythCacheSize = 32;
+// clusters are sorted for overdraw only while acmr stays within this factor of the cache optimized order
+constexpr float OverdrawAcmrThreshold = 1.05f;
+
+float calculate_acmr(const std::vector<uint32_t> &indices, uint32_t vertex_count, int cache_size)
+{
+  if (indices.empty())
+    return 0.f;
+  // timestamps instead of a real queue: vertex is cached if it was inserted less than cache_size misses ago
+  std::vector<uint32_t> insertedAt(vertex_count, 0);
+  uint32_t misses = 0;
+  for (uint32_t index : indices)
+  {
+    if (insertedAt[index] == 0 || misses - insertedAt[index] >= (uint32_t)cache_size)
+    {
+      misses++;
+      insertedAt[index] = misses;
+    }
+  }
+  return (float)misses / (indices.size() / 3);
+}
+
+struct VertexKey
+{
+  const MeshData *mesh;
+  uint32_t index;
+};
+
+template<typename T>
+static void hash_attribute(uint64_t &hash, const std::vector<T> &channel, uint32_t index)
+{
+  if (channel.empty())
+    return;
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&channel[index]);
+  for (size_t i = 0; i < sizeof(T); i++)
+    hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+}
+
+template<typename T>
+static bool equal_attribute(const std::vector<T> &channel, uint32_t a, uint32_t b)
+{
+  return channel.empty() || memcmp(&channel[a], &channel[b], sizeof(T)) == 0;
+}
+
+struct VertexKeyHash
+{
+  size_t operator()(const VertexKey &key) const
+  {
+    const MeshData &mesh = *key.mesh;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash_attribute(hash, mesh.vertices, key.index);
+    hash_attribute(hash, mesh.normals, key.index);
+    hash_attribute(hash, mesh.uv, key.index);
+    hash_attribute(hash, mesh.weights, key.index);
+    hash_attribute(hash, mesh.weightsIndex, key.index);
+    return hash;
+  }
+};
+
+struct VertexKeyEqual
+{
+  bool operator()(const VertexKey &a, const VertexKey &b) const
+  {
+    const MeshData &mesh = *a.mesh;
+    return equal_attribute(mesh.vertices, a.index, b.index) && equal_attribute(mesh.normals, a.index, b.index) &&
+      equal_attribute(mesh.uv, a.index, b.index) && equal_attribute(mesh.weights, a.index, b.index) &&
+      equal_attribute(mesh.weightsIndex, a.index, b.index);
+  }
+};
+
+template<typename T>
+static void remap_channel(std::vector<T> &channel, const std::vector<uint32_t> &remap, uint32_t new_count)
+{
+  if (channel.empty())
+    return;
+  std::vector<T> result(new_count);
+  for (size_t i = 0; i < remap.size(); i++)
+    if (remap[i] != ~0u)
+      result[remap[i]] = channel[i];
+  channel = std::move(result);
+}
+
+// remap[old] = new or ~0u for dropped vertices
+static void remap_vertices(MeshData &mesh, const std::vector<uint32_t> &remap, uint32_t new_count)
+{
+  for (uint32_t &index : mesh.indices)
+    index = remap[index];
+  remap_channel(mesh.vertices, remap, new_count);
+  remap_channel(mesh.normals, remap, new_count);
+  remap_channel(mesh.uv, remap, new_count);
+  remap_channel(mesh.weights, remap, new_count);
+  remap_channel(mesh.weightsIndex, remap, new_count);
+}
+
+static void weld_vertices(MeshData &mesh)
+{
+  const uint32_t vertexCount = mesh.vertices.size();
+  std::unordered_map<VertexKey, uint32_t, VertexKeyHash, VertexKeyEqual> unique;
+  unique.reserve(vertexCount);
+  std::vector<uint32_t> remap(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++)
+    remap[i] = unique.emplace(VertexKey{&mesh, i}, unique.size()).first->second;
+  remap_vertices(mesh, remap, unique.size());
+}
+
+static float forsyth_score(int cache_position, uint32_t remaining_triangles)
+{
+  if (remaining_triangles == 0)
+    return -1.f;
+  float score = 0.f;
+  if (cache_position >= 0)
+  {
+    // the last triangle's vertices get a fixed score, so the next triangle doesn't simply reuse them
+    if (cache_position < 3)
+      score = 0.75f;
+    else
+      score = std::pow(1.f - (cache_position - 3) * (1.f / (ForsythCacheSize - 3)), 1.5f);
+  }
+  return score + 2.f / std::sqrt((float)remaining_triangles);
+}
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation"
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t> &indices, uint32_t vertex_count)
+{
+  const uint32_t triangleCount = indices.size() / 3;
+  std::vector<uint32_t> remaining(vertex_count, 0);
+  for (uint32_t index : indices)
+    remaining[index]++;
+
+  std::vector<uint32_t> offsets(vertex_count + 1, 0);
+  for (uint32_t v = 0; v < vertex_count; v++)
+    offsets[v + 1] = offsets[v] + remaining[v];
+  std::vector<uint32_t> vertexTriangles(indices.size());
+  std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+  for (uint32_t i = 0; i < indices.size(); i++)
+    vertexTriangles[fill[indices[i]]++] = i / 3;
+
+  std::vector<int> cachePosition(vertex_count, -1);
+  std::vector<float> vertexScore(vertex_count);
+  for (uint32_t v = 0; v < vertex_count; v++)
+    vertexScore[v] = forsyth_score(-1, remaining[v]);
+
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (uint32_t t = 0; t < triangleCount; t++)
+    triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  std::vector<uint32_t> cache, newCache;
+  cache.reserve(ForsythCacheSize + 3);
+  uint32_t scanFrom = 0;
+
+  while (result.size() < indices.size())
+  {
+    // best triangle touching the cache, otherwise the next unused one in input order
+    int best = -1;
+    float bestScore = -1.f;
+    for (uint32_t v : cache)
+    {
+      for (uint32_t k = offsets[v]; k < offsets[v + 1]; k++)
+      {
+        uint32_t t = vertexTriangles[k];
+        if (!emitted[t] && triangleScore[t] > bestScore)
+        {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+    if (best < 0)
+    {
+      while (emitted[scanFrom])
+        scanFrom++;
+      best = scanFrom;
+    }
+
+    emitted[best] = true;
+    newCache.clear();
+    for (int j = 0; j < 3; j++)
+    {
+      uint32_t v = indices[best * 3 + j];
+      result.push_back(v);
+      newCache.push_back(v);
+      // drop the emitted triangle from the vertex's list of live triangles
+      uint32_t *begin = &vertexTriangles[offsets[v]];
+      uint32_t *end = begin + remaining[v];
+      *std::find(begin, end, (uint32_t)best) = *(end - 1);
+      remaining[v]--;
+    }
+    for (uint32_t v : cache)
+      if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+        newCache.push_back(v);
+
+    for (uint32_t i = 0; i < newCache.size(); i++)
+    {
+      uint32_t v = newCache[i];
+      cachePosition[v] = i < ForsythCacheSize ? (int)i : -1;
+      vertexScore[v] = forsyth_score(cachePosition[v], remaining[v]);
+    }
+    for (uint32_t v : newCache)
+      for (uint32_t k = offsets[v]; k < offsets[v] + remaining[v]; k++)
+      {
+        uint32_t t = vertexTriangles[k];
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+      }
+
+    if (newCache.size() > ForsythCacheSize)
+      newCache.resize(ForsythCacheSize);
+    std::swap(cache, newCache);
+  }
+  return result;
+}
+
+// splits the cache optimized order into clusters at hard cache misses and draws outward facing clusters first
+// (Sander, Nehab, Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+static std::vector<uint32_t> optimize_overdraw(const MeshData &mesh, const std::vector<uint32_t> &indices)
+{
+  const uint32_t triangleCount = indices.size() / 3;
+  const std::vector<vec3> &positions = mesh.vertices;
+
+  std::vector<uint32_t> clusterStart;
+  std::vector<uint32_t> insertedAt(positions.size(), 0);
+  uint32_t misses = 0;
+  for (uint32_t t = 0; t < triangleCount; t++)
+  {
+    int triangleMisses = 0;
+    for (int j = 0; j < 3; j++)
+    {
+      uint32_t index = indices[t * 3 + j];
+      if (insertedAt[index] == 0 || misses - insertedAt[index] >= FifoCacheSize)
+      {
+        misses++;
+        triangleMisses++;
+        insertedAt[index] = misses;
+      }
+    }
+    if (t == 0 || triangleMisses == 3)
+      clusterStart.push_back(t);
+  }
+  clusterStart.push_back(triangleCount);
+  const uint32_t clusterCount = clusterStart.size() - 1;
+
+  // winding sign from the signed volume, so the sort works for either face orientation
+  vec3 meshCenter(0.f);
+  float volume = 0.f;
+  for (uint32_t t = 0; t < triangleCount; t++)
+  {
+    const vec3 &a = positions[indices[t * 3]], &b = positions[indices[t * 3 + 1]], &c = positions[indices[t * 3 + 2]];
+    meshCenter += a + b + c;
+    volume += dot(a, cross(b, c));
+  }
+  meshCenter /= (float)(triangleCount * 3);
+  const float winding = volume < 0.f ? -1.f : 1.f;
+
+  std::vector<float> clusterKey(clusterCount);
+  for (uint32_t c = 0; c < clusterCount; c++)
+  {
+    vec3 centroid(0.f), normal(0.f);
+    float area = 0.f;
+    for (uint32_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+    {
+      const vec3 &a = positions[indices[t * 3]], &b = positions[indices[t * 3 + 1]], &p2 = positions[indices[t * 3 + 2]];
+      vec3 n = cross(b - a, p2 - a);
+      float triangleArea = length(n);
+      centroid += (a + b + p2) * (triangleArea / 3.f);
+      normal += n;
+      area += triangleArea;
+    }
+    centroid = area > 0.f ? centroid / area : positions[indices[clusterStart[c] * 3]];
+    float normalLength = length(normal);
+    clusterKey[c] = normalLength > 0.f ? winding * dot(centroid - meshCenter, normal / normalLength) : 0.f;
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  for (uint32_t c = 0; c < clusterCount; c++)
+    order[c] = c;
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return clusterKey[a] > clusterKey[b]; });
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (uint32_t c : order)
+    result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+  return result;
+}
+
+static void optimize_vertex_fetch(MeshData &mesh)
+{
+  std::vector<uint32_t> remap(mesh.vertices.size(), ~0u);
+  uint32_t next = 0;
+  for (uint32_t index : mesh.indices)
+    if (remap[index] == ~0u)
+      remap[index] = next++;
+  remap_vertices(mesh, remap, next);
+}
+
+MeshOptimizationStats optimize_mesh(MeshData &mesh)
+{
+  MeshOptimizationStats stats;
+  stats.verticesBefore = mesh.vertices.size();
+  stats.acmrBefore = calculate_acmr(mesh.indices, mesh.vertices.size());
+  if (mesh.indices.empty() || mesh.vertices.empty())
+  {
+    stats.verticesAfter = stats.verticesBefore;
+    stats.acmrAfter = stats.acmrBefore;
+    return stats;
+  }
+
+  weld_vertices(mesh);
+  const uint32_t vertexCount = mesh.vertices.size();
+
+  std::vector<uint32_t> cacheOrder = optimize_vertex_cache(mesh.indices, vertexCount);
+  std::vector<uint32_t> overdrawOrder = optimize_overdraw(mesh, cacheOrder);
+  const float cacheAcmr = calculate_acmr(cacheOrder, vertexCount);
+  if (calculate_acmr(overdrawOrder, vertexCount) <= cacheAcmr * OverdrawAcmrThreshold)
+    mesh.indices = std::move(overdrawOrder);
+  else
+    mesh.indices = std::move(cacheOrder);
+
+  optimize_vertex_fetch(mesh);
+
+  stats.verticesAfter = mesh.vertices.size();
+  stats.acmrAfter = calculate_acmr(mesh.indices, mesh.vertices.size());
+  return stats;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "mesh_data.h"
+
+struct MeshOptimizationStats
+{
+  uint32_t verticesBefore;
+  uint32_t verticesAfter;
+  float acmrBefore;
+  float acmrAfter;
+};
+
+// average post-transform cache miss ratio per triangle for a fifo cache of cache_size vertices
+float calculate_acmr(const std::vector<uint32_t> &indices, uint32_t vertex_count, int cache_size = 16);
+
+// triangle order for the post-transform cache, doesn't touch vertices
+std::vector<uint32_t> optimize_vertex_cache(const std::vector<uint32_t> &indices, uint32_t vertex_count);
+
+// welds identical vertices (position, normal, uv and skin), orders triangles for vertex cache and overdraw,
+// then orders vertices by first use for fetch locality
+MeshOptimizationStats optimize_mesh(MeshData &mesh);
@@ -0,0 +1,30 @@
+#include "model.h"
+#include <log.h>
+#include "cooked_model.h"
+#include "mesh_import.h"
+
+ModelPtr load_model(const char *path, bool compact_vertices)
+{
+  auto model = std::make_shared<Model>();
+  std::string cookedPath = cooked_model_path(path);
+  int meshCount = 0;
+  if (open_cooked_model(cookedPath.c_str(), path, mesh_cook_settings(compact_vertices), model->data, meshCount))
+  {
+    for (int i = 0; i < meshCount; i++)
+    {
+      model->meshes.push_back(load_mesh(path, i, compact_vertices));
+      if (!model->meshes.back())
+        return nullptr;
+    }
+    model->skeleton = make_skeleton(model->data);
+    return model;
+  }
+
+  std::vector<MeshData> meshes;
+  if (!cook_model(path, compact_vertices, meshes, model->data))
+    return nullptr;
+  for (const MeshData &mesh : meshes)
+    model->meshes.push_back(create_mesh(mesh, compact_vertices));
+  model->skeleton = make_skeleton(model->data);
+  return model;
+}
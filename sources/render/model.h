@@ -0,0 +1,18 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "model_data.h"
+#include "mesh.h"
+#include <anim/skeleton.h>
+
+// all meshes of a file with their hierarchy, materials and the bone table they share
+struct Model
+{
+  ModelData data;
+  std::vector<MeshPtr> meshes; // meshes[i] uses material data.meshMaterials[i]
+  Skeleton skeleton; // built from data.nodes and data.bones
+};
+
+using ModelPtr = std::shared_ptr<Model>;
+
+ModelPtr load_model(const char *path, bool compact_vertices = true);
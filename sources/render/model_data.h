@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <3dmath.h>
+
+struct ModelNode
+{
+  std::string name;
+  int parent; // -1 for the root, parents always come before children
+  mat4 localTransform;
+  std::vector<uint32_t> meshes;
+};
+
+struct ModelMaterial
+{
+  std::string name;
+  std::string diffuseTexture; // as written in the source file, empty if none
+};
+
+// bones of all meshes merged by name, vertex bone indices of every mesh point into this table
+struct ModelBone
+{
+  std::string name;
+  int node;
+  mat4 inverseBindPose;
+};
+
+// everything from a model file except the vertex data
+struct ModelData
+{
+  std::vector<ModelNode> nodes;
+  std::vector<ModelMaterial> materials;
+  std::vector<uint32_t> meshMaterials; // material index per mesh
+  std::vector<ModelBone> bones;
+};
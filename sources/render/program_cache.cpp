@@ -0,0 +1,103 @@
+#include "program_cache.h"
+#include <cstring>
+#include <filesystem>
+#include <cooked_file.h>
+#include <mapped_file.h>
+#include <log.h>
+#include "glad/glad.h"
+
+constexpr const char *ProgramCacheDirectory = "cache/shaders";
+constexpr uint32_t ProgramBinaryMagic = 0x47525043; // "CPRG"
+constexpr uint32_t ProgramBinaryVersion = 1;
+
+// file.settings is the key, file.count the driver's binary format
+struct ProgramBinaryHeader
+{
+  CookedFileHeader file;
+  CookedBlob binary;
+};
+
+static std::string program_binary_path(uint64_t key)
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+  return std::string(ProgramCacheDirectory) + "/" + name;
+}
+
+static bool program_binaries_supported()
+{
+  static const bool supported = []()
+  {
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+  }();
+  return supported;
+}
+
+uint64_t program_cache_key(const std::vector<std::pair<unsigned, std::string>> &stages, const std::string &defines)
+{
+  uint64_t key = hash_bytes(defines.data(), defines.size());
+  for (const auto &[type, source] : stages)
+  {
+    key = hash_bytes(&type, sizeof(type), key);
+    key = hash_bytes(source.data(), source.size(), key);
+  }
+  // binaries are only valid for the exact driver that made them
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+  {
+    const char *value = reinterpret_cast<const char *>(glGetString(name));
+    if (value)
+      key = hash_bytes(value, strlen(value), key);
+  }
+  return key;
+}
+
+unsigned load_program_binary(uint64_t key)
+{
+  if (!program_binaries_supported())
+    return 0;
+  std::string path = program_binary_path(key);
+  MappedFilePtr file = map_file(path.c_str());
+  if (!file || file->size < sizeof(ProgramBinaryHeader))
+    return 0;
+  const auto *header = reinterpret_cast<const ProgramBinaryHeader *>(file->data);
+  if (!is_cooked_header_valid(header->file, ProgramBinaryMagic, ProgramBinaryVersion, key) ||
+      header->binary.offset > file->size || header->binary.size > file->size - header->binary.offset)
+    return 0;
+
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header->file.count, file->data + header->binary.offset, header->binary.size);
+  GLint success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success)
+  {
+    // the driver may reject its own binaries, e.g. after an update that kept the version string
+    debug_log("program binary %s is rejected", path.c_str());
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+void save_program_binary(uint64_t key, unsigned program)
+{
+  if (!program_binaries_supported())
+    return;
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+  std::vector<uint8_t> binary(length);
+  GLenum format;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  std::error_code ec;
+  std::filesystem::create_directories(ProgramCacheDirectory, ec);
+  ProgramBinaryHeader header{};
+  header.file = {ProgramBinaryMagic, ProgramBinaryVersion, key, format, 0, {}};
+  const std::span<const uint8_t> blobs[] = {as_blob(binary)};
+  std::string path = program_binary_path(key);
+  if (!write_cooked_file(path.c_str(), &header, sizeof(header), std::span(&header.binary, 1), blobs))
+    debug_error("can't write program binary %s", path.c_str());
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// linked programs on disk, so a start with unchanged shaders skips glsl compilation
+// key covers every stage's type and text, the defines and the driver, so any change just misses
+
+uint64_t program_cache_key(const std::vector<std::pair<unsigned, std::string>> &stages, const std::string &defines);
+
+// returns 0 when there is no usable binary, e.g. after a driver update
+unsigned load_program_binary(uint64_t key);
+
+// program must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+void save_program_binary(uint64_t key, unsigned program);
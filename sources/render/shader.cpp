@@ -1,14 +1,51 @@
 #include "shader.h"
 #include <iostream>
 #include <map>
+#include <set>
 #include "log.h"
+#include "resource_cache.h"
+#include "program_cache.h"
+#include "file_watcher.h"
+#include "task_queue.h"
+#include "global_render_data.h"
+#include "material_buffer.h"
 #include "glad/glad.h"
 #include <filesystem>
 #include <array>
 #include <vector>
-#include <fstream>
 
 
+// the glsl side of GlobalRenderData, the c++ side is checked by static_asserts in global_render_data.h
+static void check_global_render_data(const Shader &shader)
+{
+  GLuint block = glGetUniformBlockIndex(shader.program, GlobalRenderDataBlock);
+  if (block == GL_INVALID_INDEX)
+    return;
+  const char *names[] = {"ViewProjection", "CameraPosition", "LightDirection", "AmbientLight", "SunLight"};
+  const GLint expected[] = {
+    offsetof(GlobalRenderData, viewProjection),
+    offsetof(GlobalRenderData, cameraPosition),
+    offsetof(GlobalRenderData, lightDirection),
+    offsetof(GlobalRenderData, ambientLight),
+    offsetof(GlobalRenderData, sunLight)};
+  constexpr GLsizei count = std::size(names);
+  GLuint indices[count];
+  GLint offsets[count];
+  GLint size = 0;
+  glGetUniformIndices(shader.program, count, names, indices);
+  glGetActiveUniformBlockiv(shader.program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+  if (size != sizeof(GlobalRenderData))
+    debug_error("%s in shader %s is %d bytes, expected %d", GlobalRenderDataBlock, shader.name.c_str(), size, (int)sizeof(GlobalRenderData));
+  for (GLsizei i = 0; i < count; i++)
+  {
+    if (indices[i] == GL_INVALID_INDEX)
+      continue; // unused members are optimized out
+    glGetActiveUniformsiv(shader.program, 1, &indices[i], GL_UNIFORM_OFFSET, &offsets[i]);
+    if (offsets[i] != expected[i])
+      debug_error("%s.%s in shader %s is at %d, expected %d", GlobalRenderDataBlock, names[i], shader.name.c_str(), offsets[i], expected[i]);
+  }
+}
+
 static void read_shader_info(Shader &shader)
 {
   GLuint program = shader.program;
@@ -18,6 +55,10 @@ static void read_shader_info(Shader &shader)
   GLchar name[bufSize];
   GLsizei length;
   shader.uniforms.clear();
+  GLint materialBlock = (GLint)glGetUniformBlockIndex(program, MaterialDataBlock); // -1 for GL_INVALID_INDEX
+  shader.materialBlockSize = 0;
+  if (materialBlock >= 0)
+    glGetActiveUniformBlockiv(program, materialBlock, GL_UNIFORM_BLOCK_DATA_SIZE, &shader.materialBlockSize);
   glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
   for (int i = 0; i < count; i++)
   {
@@ -27,34 +68,56 @@ static void read_shader_info(Shader &shader)
     //debug_log("uniform %s #%d Type: %u Name: %s", shader.name.c_str(), i, type, name);
 
     GLint shaderLocation = glGetUniformLocation(program, name);
-    shader.uniforms.emplace_back(ShaderUniform{std::string(name), type, shaderLocation});
+    std::string_view baseName(name, length);
+    if (baseName.ends_with("[0]"))
+      baseName.remove_suffix(3);
+    UniformId id = uniform_id(baseName);
+    for (const ShaderUniform &uniform : shader.uniforms)
+      if (uniform.id == id)
+        debug_error("uniforms %s and %s in shader %s have the same id", uniform.name.c_str(), name, shader.name.c_str());
+    GLuint index = i;
+    GLint blockIndex, blockOffset = -1;
+    glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+    if (materialBlock >= 0 && blockIndex == materialBlock)
+      glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &blockOffset);
+    shader.uniforms.emplace_back(ShaderUniform{std::string(name), id, type, shaderLocation, blockOffset});
   }
+  check_global_render_data(shader);
 }
 
-struct ShaderInfo
+static const char *stage_name(GLenum type)
 {
-  GLenum shaderType;
-  std::string path;
-  std::string sources;
-};
+  return type == GL_VERTEX_SHADER ? "vertex" : type == GL_FRAGMENT_SHADER ? "pixel" : "unknown";
+}
 
-static bool compile_shader(const char *shaderName, const std::vector<ShaderInfo> &shaders, GLuint &program)
+static bool compile_shader(const char *shaderName, const PreprocessedShader &shaders, const std::string &defines, GLuint &program)
 {
+  const uint64_t cacheKey = program_cache_key(shaders.stages, defines);
+  if ((program = load_program_binary(cacheKey)))
+    return true;
+
   std::vector<GLuint> compiled_shaders;
-  compiled_shaders.reserve(shaders.size());
+  compiled_shaders.reserve(shaders.stages.size());
   GLchar infoLog[1024];
   GLint success;
-  for (const ShaderInfo &shader : shaders)
+  for (const auto &[shaderType, sources] : shaders.stages)
   {
-    GLuint shaderProg = glCreateShader(shader.shaderType);
-    const GLchar * shaderCode = shader.sources.c_str();
+    GLuint shaderProg = glCreateShader(shaderType);
+    const GLchar * shaderCode = sources.c_str();
     glShaderSource(shaderProg, 1, &shaderCode, NULL);
     glCompileShader(shaderProg);
     glGetShaderiv(shaderProg, GL_COMPILE_STATUS, &success);
     if(!success)
     {
-      glGetShaderInfoLog(shaderProg, 512, NULL, infoLog);
-      debug_error("Shader (%s) compilation failed!\n Log: %s", shader.path.c_str(), infoLog);
+      glGetShaderInfoLog(shaderProg, sizeof(infoLog), NULL, infoLog);
+      std::string files;
+      for (size_t i = 0; i < shaders.files.size(); i++)
+        files += "\n " + std::to_string(i) + ": " + shaders.files[i];
+      debug_error("Shader (%s, %s stage, %s) compilation failed!\n Files:%s\n Log: %s",
+                  shaderName, stage_name(shaderType), defines.c_str(), files.c_str(), infoLog);
+      glDeleteShader(shaderProg);
+      for (GLuint compiled : compiled_shaders)
+        glDeleteShader(compiled);
       return false;
     };
     compiled_shaders.push_back(shaderProg);
@@ -62,58 +125,123 @@ static bool compile_shader(const char *shaderName, const std::vector<ShaderInfo>
 
 
   program = glCreateProgram();
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
   for (GLuint shaderProg : compiled_shaders)
     glAttachShader(program, shaderProg);
 
   glLinkProgram(program);
   glGetProgramiv(program, GL_LINK_STATUS, &success);
 
+  for (GLuint shaderProg : compiled_shaders)
+    glDeleteShader(shaderProg);
   if (!success)
   {
     glGetProgramInfoLog(program, 1024, NULL, infoLog);
     debug_error("Shader programm (%s) linking failed!\n Log: %s", shaderName, infoLog);
+    glDeleteProgram(program);
     return false;
   }
 
-  for (GLuint shaderProg : compiled_shaders)
-    glDeleteShader(shaderProg);
+  save_program_binary(cacheKey, program);
   return true;
 }
 
+static std::vector<ShaderPtr> shaderList;
+static ResourceCache<Shader> shaderCache("shader");
 
-
-static std::string read_file(const char *path)
+static void swap_program(Shader &shader, GLuint program)
 {
-  std::ifstream file(path);
-  return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  glDeleteProgram(shader.program);
+  shader.program = program;
+  shader.generation++;
+  read_shader_info(shader);
 }
 
-static bool compile_shader(const char *name, const Shader::ShaderSources &sources, GLuint &program)
-{
-  std::vector<ShaderInfo> shaderCode;
+static void reload_shader(const ShaderPtr &shader);
 
-  for (const auto &[shaderType, path] : sources)
+// every file a shader was built from, includes too, so editing a shared include reloads all its users
+static std::set<std::pair<const Shader *, std::string>> watchedFiles;
+
+static void watch_sources(const ShaderPtr &shader, const std::vector<std::string> &files)
+{
+  std::weak_ptr<Shader> weak = shader;
+  for (const std::string &path : files)
   {
-    shaderCode.emplace_back(ShaderInfo{shaderType, path, read_file(path.c_str())});
+    if (!watchedFiles.emplace(shader.get(), path).second)
+      continue;
+    watch_file(path, [weak]()
+    {
+      if (ShaderPtr shader = weak.lock())
+        reload_shader(shader);
+    });
   }
-  return compile_shader(name, shaderCode, program);
 }
 
-static std::vector<ShaderPtr> shaderList;
+// reload requests per shader, a reload that finishes after a newer one is dropped
+static std::map<const Shader *, std::pair<uint64_t, uint64_t>> reloadCounters; // requested, applied
 
-ShaderPtr compile_shader(const char *name, const char *vs_path, const char *ps_path)
+// sources are read and preprocessed on a worker, the program is compiled and swapped at the start of a frame
+// on the main thread, a program that fails to compile stays as it was
+static void reload_shader(const ShaderPtr &shader)
 {
-  Shader::ShaderSources shaderSources{{GL_VERTEX_SHADER, vs_path}, {GL_FRAGMENT_SHADER, ps_path}};
+  const uint64_t request = ++reloadCounters[shader.get()].first;
+  run_async([shader, request]()
+  {
+    auto preprocessed = std::make_shared<PreprocessedShader>();
+    if (!preprocess_shader(shader->shaderSources, shader->defines, *preprocessed))
+      return;
 
-  GLuint program;
-  if (compile_shader(name, shaderSources, program))
+    run_on_main_thread([shader, request, preprocessed]()
+    {
+      uint64_t &applied = reloadCounters[shader.get()].second;
+      if (request < applied)
+        return;
+      applied = request;
+      watch_sources(shader, preprocessed->files);
+      GLuint program;
+      if (compile_shader(shader->name.c_str(), *preprocessed, shader_defines_key(shader->defines), program))
+      {
+        swap_program(*shader, program);
+        debug_log("shader %s reloaded", shader->name.c_str());
+      }
+    });
+  });
+}
+
+// variants are compiled on first request and shared by source files and define set,
+// the name of the first request is kept
+static ShaderPtr compile_shader(const char *name, const Shader::ShaderSources &sources, const ShaderDefines &defines)
+{
+  std::string definesKey = shader_defines_key(defines);
+  std::string cacheKey;
+  for (const auto &[shaderType, path] : sources)
+    cacheKey += path + "|";
+  cacheKey += definesKey;
+
+  return shaderCache.get_or_create(cacheKey, [&]() -> ShaderPtr
   {
-    auto shader = std::make_shared<Shader>(name, program, shaderSources);
-    read_shader_info(*shader);
-    shaderList.push_back(shader);
-    return shader;
-  }
-  return nullptr;
+    PreprocessedShader preprocessed;
+    GLuint program;
+    if (preprocess_shader(sources, defines, preprocessed) && compile_shader(name, preprocessed, definesKey, program))
+    {
+      auto shader = std::make_shared<Shader>(name, program, sources, defines);
+      read_shader_info(*shader);
+      shaderList.push_back(shader);
+      watch_sources(shader, preprocessed.files);
+      return shader;
+    }
+    return nullptr;
+  });
+}
+
+ShaderPtr compile_shader(const char *name, const char *vs_path, const char *ps_path, const ShaderDefines &defines)
+{
+  return compile_shader(name, {{GL_VERTEX_SHADER, vs_path}, {GL_FRAGMENT_SHADER, ps_path}}, defines);
+}
+
+ShaderPtr compile_shader(const char *name, const char *path, const ShaderDefines &defines)
+{
+  return compile_shader(name, {{AllShaderStages, path}}, defines);
 }
 
 
@@ -121,12 +249,10 @@ void recompile_all_shaders()
 {
   for (auto &shader : shaderList)
   {
+    PreprocessedShader preprocessed;
     GLuint program;
-    if (compile_shader(shader->name.c_str(), shader->shaderSources, program))
-    {
-      glDeleteProgram(shader->program);
-      shader->program = program;
-      read_shader_info(*shader);
-    }
+    if (preprocess_shader(shader->shaderSources, shader->defines, preprocessed) &&
+        compile_shader(shader->name.c_str(), preprocessed, shader_defines_key(shader->defines), program))
+      swap_program(*shader, program);
   }
-}
\ No newline at end of file
+}
@@ -4,13 +4,17 @@
 #include <string>
 #include <memory>
 #include "glad/glad.h"
+#include "shader_preprocessor.h"
+#include "uniform_id.h"
 
 
 struct ShaderUniform
 {
   std::string name;
+  UniformId id; // of the name without an array suffix
   unsigned int type;
   int shaderLocation;
+  int materialBlockOffset; // -1 when not in the MaterialData block
 };
 
 
@@ -21,13 +25,17 @@ public:
 	using ShaderSources = std::vector<std::pair<GLuint, std::string>>;
 
 	const std::string name;
-	const ShaderSources shaderSources; //for hotreload
+	const ShaderSources shaderSources; //for hotreload, AllShaderStages type for single file shaders
+	const ShaderDefines defines;
 	GLuint program;
   std::vector<ShaderUniform> uniforms;
+  int generation = 0; // bumped when a reload replaces program and uniforms
+  int materialBlockSize = 0; // 0 when the program has no MaterialData block
 
-	Shader(const std::string &shader_name, GLuint shader_program, ShaderSources sources):
+	Shader(const std::string &shader_name, GLuint shader_program, ShaderSources sources, ShaderDefines shader_defines = {}):
 		name(shader_name),
 		shaderSources(sources),
+		defines(shader_defines),
 		program(shader_program)
 	{}
 
@@ -40,6 +48,15 @@ public:
 	{
 		return glGetUniformLocation(program, name);
 	}
+	// index into uniforms, -1 when the program has no such uniform
+	// a linear search, callers resolve it once per generation and keep the index
+	int find_uniform(UniformId id) const
+	{
+		for (size_t i = 0; i < uniforms.size(); i++)
+			if (uniforms[i].id == id)
+				return i;
+		return -1;
+	}
 	void set_mat3x3(const char*name, const mat3 &matrix, bool transpose = false) const
 	{
 		glUniformMatrix3fv(glGetUniformLocation(program, name), 1, transpose, glm::value_ptr(matrix));
@@ -105,6 +122,9 @@ public:
 
 using ShaderPtr = std::shared_ptr<Shader>;
 
-ShaderPtr compile_shader(const char *name, const char *vs_path, const char *ps_path);
+ShaderPtr compile_shader(const char *name, const char *vs_path, const char *ps_path, const ShaderDefines &defines = {});
+
+// single file with #vertex_shader and #pixel_shader sections, see shaders/bones.glsl
+ShaderPtr compile_shader(const char *name, const char *path, const ShaderDefines &defines = {});
 
 void recompile_all_shaders();
@@ -0,0 +1,222 @@
+#include "shader_preprocessor.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include "log.h"
+#include "glad/glad.h"
+
+constexpr const char *DefaultShaderVersion = "#version 450";
+
+static bool read_file(const std::string &path, std::string &text)
+{
+  std::ifstream file(path);
+  if (!file)
+    return false;
+  text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static bool starts_with_directive(const std::string &line, const char *directive, std::string *rest = nullptr)
+{
+  size_t begin = line.find_first_not_of(" \t");
+  if (begin == std::string::npos || line.compare(begin, strlen(directive), directive) != 0)
+    return false;
+  size_t end = begin + strlen(directive);
+  if (end < line.size() && !isspace((unsigned char)line[end]))
+    return false;
+  if (rest)
+  {
+    size_t restBegin = line.find_first_not_of(" \t\r", end);
+    *rest = restBegin == std::string::npos ? "" : line.substr(restBegin);
+  }
+  return true;
+}
+
+static unsigned stage_marker(const std::string &line)
+{
+  if (starts_with_directive(line, "#vertex_shader"))
+    return GL_VERTEX_SHADER;
+  if (starts_with_directive(line, "#pixel_shader"))
+    return GL_FRAGMENT_SHADER;
+  return AllShaderStages;
+}
+
+struct StageBuilder
+{
+  PreprocessedShader &result;
+  std::string text;
+  std::string version;
+  std::set<std::string> included;
+  std::vector<std::string> includeStack;
+
+  explicit StageBuilder(PreprocessedShader &result) : result(result) {}
+
+  int file_index(const std::string &path)
+  {
+    auto it = std::find(result.files.begin(), result.files.end(), path);
+    if (it != result.files.end())
+      return it - result.files.begin();
+    result.files.push_back(path);
+    return result.files.size() - 1;
+  }
+
+  bool add_file(const std::string &path)
+  {
+    std::string source;
+    if (!read_file(path, source))
+    {
+      debug_error("can't read shader file %s", path.c_str());
+      return false;
+    }
+    includeStack.push_back(path);
+    bool ok = add_text(source, path, 1);
+    includeStack.pop_back();
+    return ok;
+  }
+
+  // first_line is the line number of text inside path
+  bool add_text(const std::string &source, const std::string &path, int first_line)
+  {
+    const int fileIdx = file_index(path);
+    text += "#line " + std::to_string(first_line) + " " + std::to_string(fileIdx) + "\n";
+
+    int lineNumber = first_line;
+    for (size_t pos = 0; pos < source.size(); lineNumber++)
+    {
+      size_t end = source.find('\n', pos);
+      if (end == std::string::npos)
+        end = source.size();
+      std::string line = source.substr(pos, end - pos);
+      pos = end + 1;
+
+      std::string argument;
+      if (starts_with_directive(line, "#include", &argument))
+      {
+        if (argument.size() < 2 || argument.front() != '"' || argument.find('"', 1) == std::string::npos)
+        {
+          debug_error("%s(%d): expected #include \"file\"", path.c_str(), lineNumber);
+          return false;
+        }
+        std::string name = argument.substr(1, argument.find('"', 1) - 1);
+        std::string includePath = (std::filesystem::path(path).parent_path() / name).lexically_normal().generic_string();
+        if (std::find(includeStack.begin(), includeStack.end(), includePath) != includeStack.end())
+        {
+          debug_error("%s(%d): recursive include of %s", path.c_str(), lineNumber, includePath.c_str());
+          return false;
+        }
+        if (included.insert(includePath).second)
+        {
+          if (!add_file(includePath))
+            return false;
+          text += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIdx) + "\n";
+          continue;
+        }
+        line.clear();
+      }
+      else if (starts_with_directive(line, "#version"))
+      {
+        if (version.empty())
+          version = line;
+        line.clear();
+      }
+      else if (starts_with_directive(line, "#pragma", &argument) && argument.rfind("once", 0) == 0)
+      {
+        line.clear();
+      }
+      text += line;
+      text += '\n';
+    }
+    return true;
+  }
+
+  std::string finish(const ShaderDefines &defines) const
+  {
+    std::string header = (version.empty() ? DefaultShaderVersion : version) + "\n";
+    for (const auto &[name, value] : defines)
+      header += "#define " + name + (value.empty() ? "" : " " + value) + "\n";
+    return header + text;
+  }
+};
+
+struct StageSection
+{
+  unsigned type;
+  int firstLine;
+  std::string text;
+};
+
+// common part first with type AllShaderStages, then one section per marker
+static std::vector<StageSection> split_stages(const std::string &source)
+{
+  std::vector<StageSection> sections{{AllShaderStages, 1, ""}};
+  int lineNumber = 1;
+  for (size_t pos = 0; pos < source.size(); lineNumber++)
+  {
+    size_t end = source.find('\n', pos);
+    if (end == std::string::npos)
+      end = source.size();
+    std::string line = source.substr(pos, end - pos);
+    pos = end + 1;
+
+    if (unsigned type = stage_marker(line))
+      sections.push_back({type, lineNumber + 1, ""});
+    else if (starts_with_directive(line, "#shader"))
+      sections.back().text += '\n';
+    else
+      sections.back().text += line + '\n';
+  }
+  return sections;
+}
+
+std::string shader_defines_key(const ShaderDefines &defines)
+{
+  ShaderDefines sorted = defines;
+  std::sort(sorted.begin(), sorted.end());
+  std::string key;
+  for (const auto &[name, value] : sorted)
+    key += value.empty() ? name + ";" : name + "=" + value + ";";
+  return key;
+}
+
+bool preprocess_shader(const std::vector<std::pair<unsigned, std::string>> &sources, const ShaderDefines &defines,
+                       PreprocessedShader &result)
+{
+  result = {};
+  for (const auto &[type, path] : sources)
+  {
+    if (type != AllShaderStages)
+    {
+      StageBuilder stage(result);
+      if (!stage.add_file(path))
+        return false;
+      result.stages.emplace_back(type, stage.finish(defines));
+      continue;
+    }
+
+    std::string source;
+    if (!read_file(path, source))
+    {
+      debug_error("can't read shader file %s", path.c_str());
+      return false;
+    }
+    std::vector<StageSection> sections = split_stages(source);
+    if (sections.size() == 1)
+    {
+      debug_error("%s has no #vertex_shader or #pixel_shader section", path.c_str());
+      return false;
+    }
+    for (size_t i = 1; i < sections.size(); i++)
+    {
+      StageBuilder stage(result);
+      stage.includeStack.push_back(path);
+      if (!stage.add_text(sections[0].text, path, sections[0].firstLine) ||
+          !stage.add_text(sections[i].text, path, sections[i].firstLine))
+        return false;
+      result.stages.emplace_back(sections[i].type, stage.finish(defines));
+    }
+  }
+  return true;
+}
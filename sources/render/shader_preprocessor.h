@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// name, value; an empty value is a plain #define NAME
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// stage type for a single file holding all stages after #vertex_shader/#pixel_shader markers,
+// text before the first marker is shared by every stage
+constexpr unsigned AllShaderStages = 0;
+
+struct PreprocessedShader
+{
+  std::vector<std::pair<unsigned, std::string>> stages; // gl shader type, text
+  // #line source numbers index this, so driver logs like "2(15)" point to files[2] line 15
+  std::vector<std::string> files;
+};
+
+// sorted "NAME=VALUE;" list, equal for the same define set in any order
+std::string shader_defines_key(const ShaderDefines &defines);
+
+// expands #include "file" relative to the including file (once per stage), splits single file shaders into stages,
+// puts #version first and the defines right after it
+bool preprocess_shader(const std::vector<std::pair<unsigned, std::string>> &sources, const ShaderDefines &defines,
+                       PreprocessedShader &result);
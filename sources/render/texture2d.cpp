@@ -1,57 +1,110 @@
 #include "texture2d.h"
 #include "glad/glad.h"
+#include <algorithm>
 #include <cassert>
 #include <log.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
+#include <task_queue.h>
+#include <resource_cache.h>
+#include "texture_source.h"
+#include "texture_uploader.h"
+#include "texture_streaming.h"
 
-Texture2DPtr create_texture(const unsigned char *image, int w, int h, int ch)
+// levels up to this size are uploaded at creation, so a new texture is never sampled empty and never streamed out
+constexpr uint64_t ImmediateUploadBytes = 64 << 10;
+
+Texture2D::~Texture2D()
+{
+  glDeleteTextures(1, &textureObject);
+}
+
+// only the small tail of the chain is uploaded up front, finer levels go through the upload queue and the streamer
+// brings them in once the texture is seen on screen large enough to need them, owner keeps levels alive
+static Texture2DPtr create_texture(TextureFormat format, uint32_t width, uint32_t height,
+  std::vector<std::span<const uint8_t>> levels, std::shared_ptr<const void> owner)
 {
+  const int levelCount = levels.size();
+  // the last level is always there, whatever its size
+  int tail = levelCount - 1;
+  while (tail > 0 && levels[tail - 1].size() <= ImmediateUploadBytes)
+    tail--;
+
+  const uint32_t tailWidth = std::max(1u, width >> tail), tailHeight = std::max(1u, height >> tail);
   GLuint textureObject;
   glGenTextures(1, &textureObject);
   auto texture = std::make_shared<Texture2D>(textureObject);
-  GLuint textureType = GL_TEXTURE_2D;
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+  glTexStorage2D(GL_TEXTURE_2D, levelCount - tail, gl_internal_format(format), tailWidth, tailHeight);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount - tail > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  for (int i = tail; i < levelCount; i++)
+  {
+    const uint32_t levelWidth = std::max(1u, width >> i), levelHeight = std::max(1u, height >> i);
+    upload_texture_level(textureObject, format, i - tail, levelWidth, levelHeight, levels[i]);
+  }
 
-  glBindTexture(textureType, textureObject);
+  register_streamed_texture(texture, format, width, height, std::move(levels), tail, std::move(owner));
+  return texture;
+}
 
-  if (ch == 4)
-    glTexImage2D(textureType, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-  else if (ch == 3)
-    glTexImage2D(textureType, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+// sources that couldn't be cooked come with an rgba mip chain built by read_texture, they load the same way
+static Texture2DPtr create_texture(std::shared_ptr<const TextureSource> source)
+{
+  std::vector<std::span<const uint8_t>> levels;
+  if (source->cooked)
+  {
+    const CookedTextureHeader &header = *source->cooked->header;
+    for (uint32_t i = 0; i < header.levelCount; i++)
+      levels.push_back(source->cooked->level(i));
+    return create_texture(header.format, header.width, header.height, std::move(levels), std::move(source));
+  }
+  const TextureData &base = source->decoded[0];
+  for (const TextureData &level : source->decoded)
+    levels.push_back(level.pixels);
+  return create_texture(TextureFormat::RGBA8, base.width, base.height, std::move(levels), std::move(source));
+}
+
+static AsyncResourceCache<Texture2D> textureCache("texture");
 
-  const bool generateMips = true;
-  if (generateMips)
+Texture2DPtr create_texture2d(const char *path)
+{
+  return textureCache.get_or_load(path, [path]() -> Texture2DPtr
   {
-    glGenerateMipmap(textureType);
-    GLenum mipmapMinPixelFormat = GL_LINEAR_MIPMAP_LINEAR;
-    GLenum mipmapMagPixelFormat = GL_LINEAR;
+    auto source = std::make_shared<TextureSource>();
+    if (!read_texture(path, *source))
+      return nullptr;
+    return create_texture(std::move(source));
+  });
+}
 
-    glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, mipmapMinPixelFormat);
-    glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, mipmapMagPixelFormat);
-  }
-  else
+// held only by the handles still loading, so it's gone with the gl context like every other texture
+static Texture2DPtr placeholder_texture()
+{
+  static std::weak_ptr<Texture2D> shared;
+  Texture2DPtr placeholder = shared.lock();
+  if (!placeholder)
   {
-    GLenum minMagixelFormat = GL_LINEAR;
-    glTexParameteri(textureType, GL_TEXTURE_MIN_FILTER, minMagixelFormat);
-    glTexParameteri(textureType, GL_TEXTURE_MAG_FILTER, minMagixelFormat);
+    static const uint8_t grey[4] = {128, 128, 128, 255};
+    placeholder = create_texture(TextureFormat::RGBA8, 1, 1, {std::span<const uint8_t>(grey)}, nullptr);
+    shared = placeholder;
   }
-  glBindTexture(textureType, 0);
-
-  return texture;
+  return placeholder;
 }
 
-Texture2DPtr create_texture2d(const char *path)
+Texture2DHandle create_texture2d_async(const char *path)
 {
-  int w, h, ch;
-  stbi_set_flip_vertically_on_load(true);
-  debug_log("loading %s", path);
-  auto stbiData = stbi_load(path, &w, &h, &ch, 0);
-  //assert(ch == 4);
-  Texture2DPtr result;
-  if (stbiData)
+  std::string key = path;
+  return textureCache.get_or_start(key, placeholder_texture(), [&]()
   {
-    result = create_texture(stbiData, w, h, ch);
-    stbi_image_free(stbiData);
-  }
-  return result;
+    run_async([key]()
+    {
+      auto source = std::make_shared<TextureSource>();
+      if (!read_texture(key.c_str(), *source))
+      {
+        run_on_main_thread([key]() { textureCache.finish(key, nullptr); });
+        return;
+      }
+      run_on_main_thread([key, source]() { textureCache.finish(key, create_texture(source)); });
+    });
+  });
 }
@@ -1,13 +1,21 @@
 #pragma once
 
 #include <memory>
+#include <async_resource.h>
 
 struct Texture2D
 {
-  const unsigned textureObject;
+  unsigned textureObject; // streaming swaps it when the resident levels change
   Texture2D(unsigned textureObject) : textureObject(textureObject) {}
+  Texture2D(const Texture2D &) = delete;
+  ~Texture2D();
 };
 
 using Texture2DPtr = std::shared_ptr<Texture2D>;
 
-Texture2DPtr create_texture2d(const char *path);
\ No newline at end of file
+using Texture2DHandle = AsyncResourcePtr<Texture2D>;
+
+Texture2DPtr create_texture2d(const char *path);
+
+// decodes on a worker thread, the handle shows a 1x1 grey texture until the upload is done
+Texture2DHandle create_texture2d_async(const char *path);
\ No newline at end of file
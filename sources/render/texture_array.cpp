@@ -0,0 +1,148 @@
+#include "texture_array.h"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <log.h>
+#include <task_queue.h>
+#include <resource_cache.h>
+#include "glad/glad.h"
+#include "texture_source.h"
+#include "texture_uploader.h"
+
+constexpr uint32_t InitialArrayCapacity = 4;
+
+using TextureArrayKey = std::tuple<TextureFormat, uint32_t, uint32_t, uint32_t>;
+static std::map<TextureArrayKey, std::weak_ptr<TextureArray>> textureArrays;
+
+TextureArray::~TextureArray()
+{
+  glDeleteTextures(1, &textureObject);
+  textureArrays.erase(TextureArrayKey(format, width, height, levelCount));
+}
+
+TextureLayer::~TextureLayer()
+{
+  array->freeLayers.push_back(layer);
+  array->usedLayers--;
+}
+
+// new storage with room for capacity layers, the used layers are copied on the gpu
+static void grow(TextureArray &array, uint32_t capacity)
+{
+  GLuint object;
+  glGenTextures(1, &object);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, object);
+  glTexStorage3D(GL_TEXTURE_2D_ARRAY, array.levelCount, gl_internal_format(array.format), array.width, array.height, capacity);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, array.levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  if (array.textureObject)
+  {
+    for (uint32_t i = 0; i < array.levelCount; i++)
+    {
+      const uint32_t w = std::max(1u, array.width >> i), h = std::max(1u, array.height >> i);
+      glCopyImageSubData(array.textureObject, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, object, GL_TEXTURE_2D_ARRAY, i, 0, 0, 0, w, h, array.capacity);
+    }
+    glDeleteTextures(1, &array.textureObject);
+  }
+  for (uint32_t layer = capacity; layer-- > array.capacity;)
+    array.freeLayers.push_back(layer);
+  array.textureObject = object;
+  array.capacity = capacity;
+}
+
+static TextureLayerPtr allocate_layer(TextureFormat format, uint32_t width, uint32_t height, uint32_t level_count)
+{
+  TextureArrayKey key(format, width, height, level_count);
+  TextureArrayPtr array = textureArrays[key].lock();
+  if (!array)
+  {
+    array = std::make_shared<TextureArray>(format, width, height, level_count);
+    textureArrays[key] = array;
+  }
+  if (array->freeLayers.empty())
+    grow(*array, std::max(InitialArrayCapacity, array->capacity * 2));
+  uint32_t layer = array->freeLayers.back();
+  array->freeLayers.pop_back();
+  array->usedLayers++;
+  return std::make_shared<TextureLayer>(std::move(array), layer);
+}
+
+static TextureLayerPtr create_layer(TextureFormat format, uint32_t width, uint32_t height,
+  const std::vector<std::span<const uint8_t>> &levels)
+{
+  TextureLayerPtr layer = allocate_layer(format, width, height, levels.size());
+  glBindTexture(GL_TEXTURE_2D_ARRAY, layer->array->textureObject);
+  for (uint32_t i = 0; i < levels.size(); i++)
+  {
+    const uint32_t w = std::max(1u, width >> i), h = std::max(1u, height >> i);
+    if (format == TextureFormat::RGBA8)
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer->layer, w, h, 1, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].data());
+    else
+      glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer->layer, w, h, 1, gl_internal_format(format),
+        levels[i].size(), levels[i].data());
+  }
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  return layer;
+}
+
+// an uncooked source comes with the rgba mip chain read_texture built, layers of one array need the same chain
+static TextureLayerPtr create_layer(const TextureSource &source)
+{
+  std::vector<std::span<const uint8_t>> levels;
+  if (source.cooked)
+  {
+    const CookedTextureHeader &header = *source.cooked->header;
+    for (uint32_t i = 0; i < header.levelCount; i++)
+      levels.push_back(source.cooked->level(i));
+    return create_layer(header.format, header.width, header.height, levels);
+  }
+  for (const TextureData &mip : source.decoded)
+    levels.push_back(mip.pixels);
+  return create_layer(TextureFormat::RGBA8, source.decoded[0].width, source.decoded[0].height, levels);
+}
+
+static AsyncResourceCache<TextureLayer> layerCache("texture layer");
+
+TextureLayerPtr load_texture_layer(const char *path)
+{
+  return layerCache.get_or_load(path, [path]() -> TextureLayerPtr
+  {
+    TextureSource source;
+    if (!read_texture(path, source))
+      return nullptr;
+    return create_layer(source);
+  });
+}
+
+// held only by the handles still loading, like the texture placeholder
+static TextureLayerPtr placeholder_layer()
+{
+  static std::weak_ptr<TextureLayer> shared;
+  TextureLayerPtr placeholder = shared.lock();
+  if (!placeholder)
+  {
+    const uint8_t grey[4] = {128, 128, 128, 255};
+    placeholder = create_layer(TextureFormat::RGBA8, 1, 1, {std::span<const uint8_t>(grey)});
+    shared = placeholder;
+  }
+  return placeholder;
+}
+
+TextureLayerHandle load_texture_layer_async(const char *path)
+{
+  std::string key = path;
+  return layerCache.get_or_start(key, placeholder_layer(), [&]()
+  {
+    run_async([key]()
+    {
+      auto source = std::make_shared<TextureSource>();
+      if (!read_texture(key.c_str(), *source))
+      {
+        run_on_main_thread([key]() { layerCache.finish(key, nullptr); });
+        return;
+      }
+      run_on_main_thread([key, source]() { layerCache.finish(key, create_layer(*source)); });
+    });
+  });
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <async_resource.h>
+#include "texture_compressor.h"
+
+// textures of one format, size and mip count share a GL_TEXTURE_2D_ARRAY, one layer each,
+// so materials that differ only in such textures can be drawn in one instanced call
+struct TextureArray
+{
+  unsigned textureObject; // replaced when the array grows
+  const TextureFormat format;
+  const uint32_t width;
+  const uint32_t height;
+  const uint32_t levelCount;
+  uint32_t capacity = 0;
+  std::vector<uint32_t> freeLayers;
+  uint32_t usedLayers = 0;
+
+  TextureArray(TextureFormat format, uint32_t width, uint32_t height, uint32_t level_count) :
+    textureObject(0), format(format), width(width), height(height), levelCount(level_count) {}
+  TextureArray(const TextureArray &) = delete;
+  ~TextureArray();
+};
+
+using TextureArrayPtr = std::shared_ptr<TextureArray>;
+
+// the layer goes back to its array with the last reference
+struct TextureLayer
+{
+  const TextureArrayPtr array;
+  const uint32_t layer;
+
+  TextureLayer(TextureArrayPtr array, uint32_t layer) : array(std::move(array)), layer(layer) {}
+  TextureLayer(const TextureLayer &) = delete;
+  ~TextureLayer();
+};
+
+using TextureLayerPtr = std::shared_ptr<TextureLayer>;
+using TextureLayerHandle = AsyncResourcePtr<TextureLayer>;
+
+// loads the whole mip chain into a layer of the array matching the texture, arrays aren't streamed
+TextureLayerPtr load_texture_layer(const char *path);
+
+// reads and decodes on a worker thread, the handle shows a grey layer until the upload is done
+TextureLayerHandle load_texture_layer_async(const char *path);
@@ -0,0 +1,440 @@
+#include "texture_compressor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint64_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height)
+{
+  const uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+  switch (format)
+  {
+    case TextureFormat::BC1: return blocks * 8;
+    case TextureFormat::BC3:
+    case TextureFormat::BC7: return blocks * 16;
+    default: return (uint64_t)width * height * 4;
+  }
+}
+
+static TextureData to_rgba(const TextureData &texture)
+{
+  TextureData rgba;
+  rgba.width = texture.width;
+  rgba.height = texture.height;
+  rgba.channels = 4;
+  rgba.pixels.resize((size_t)texture.width * texture.height * 4);
+  const int ch = texture.channels;
+  for (size_t i = 0; i < (size_t)texture.width * texture.height; i++)
+  {
+    const uint8_t *src = texture.pixels.data() + i * ch;
+    uint8_t *dst = rgba.pixels.data() + i * 4;
+    // grey and grey-alpha images are replicated to rgb
+    dst[0] = src[0];
+    dst[1] = ch >= 3 ? src[1] : src[0];
+    dst[2] = ch >= 3 ? src[2] : src[0];
+    dst[3] = ch == 4 ? src[3] : ch == 2 ? src[1] : 255;
+  }
+  return rgba;
+}
+
+std::vector<TextureData> generate_mips(const TextureData &texture)
+{
+  std::vector<TextureData> levels;
+  levels.push_back(to_rgba(texture));
+  while (levels.back().width > 1 || levels.back().height > 1)
+  {
+    const TextureData &src = levels.back();
+    TextureData dst;
+    dst.width = std::max(1, src.width / 2);
+    dst.height = std::max(1, src.height / 2);
+    dst.channels = 4;
+    dst.pixels.resize((size_t)dst.width * dst.height * 4);
+    for (int y = 0; y < dst.height; y++)
+    {
+      const int y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+      for (int x = 0; x < dst.width; x++)
+      {
+        const int x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+        for (int c = 0; c < 4; c++)
+        {
+          auto at = [&](int sx, int sy) { return (int)src.pixels[((size_t)sy * src.width + sx) * 4 + c]; };
+          dst.pixels[((size_t)y * dst.width + x) * 4 + c] = (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1) + 2) / 4;
+        }
+      }
+    }
+    levels.push_back(std::move(dst));
+  }
+  return levels;
+}
+
+TextureFormat choose_texture_format(const TextureData &rgba, TextureCompression compression)
+{
+  switch (compression)
+  {
+    case TextureCompression::None: return TextureFormat::RGBA8;
+    case TextureCompression::BC7: return TextureFormat::BC7;
+    default: break;
+  }
+  for (size_t i = 3; i < rgba.pixels.size(); i += 4)
+    if (rgba.pixels[i] != 255)
+      return TextureFormat::BC3;
+  return TextureFormat::BC1;
+}
+
+// 4x4 pixels, rgba
+using Block = uint8_t[16][4];
+
+// principal axis of the first N channels of the block by power iteration
+template<int N>
+static void principal_axis(const Block &block, float mean[N], float axis[N])
+{
+  for (int c = 0; c < N; c++)
+  {
+    mean[c] = 0.f;
+    for (int i = 0; i < 16; i++)
+      mean[c] += block[i][c];
+    mean[c] /= 16.f;
+  }
+  float cov[N][N] = {};
+  for (int i = 0; i < 16; i++)
+    for (int a = 0; a < N; a++)
+      for (int b = 0; b < N; b++)
+        cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+
+  for (int c = 0; c < N; c++)
+    axis[c] = 1.f;
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[N] = {};
+    float norm = 0.f;
+    for (int a = 0; a < N; a++)
+    {
+      for (int b = 0; b < N; b++)
+        next[a] += cov[a][b] * axis[b];
+      norm = std::max(norm, std::abs(next[a]));
+    }
+    // flat block, any axis works
+    if (norm < 1e-6f)
+      return;
+    for (int c = 0; c < N; c++)
+      axis[c] = next[c] / norm;
+  }
+}
+
+// endpoints along the principal axis, inset a little since the extremes are rarely hit exactly
+template<int N>
+static void fit_endpoints(const Block &block, float e0[N], float e1[N])
+{
+  float mean[N], axis[N];
+  principal_axis<N>(block, mean, axis);
+  float lo = 0.f, hi = 0.f;
+  for (int i = 0; i < 16; i++)
+  {
+    float t = 0.f;
+    for (int c = 0; c < N; c++)
+      t += (block[i][c] - mean[c]) * axis[c];
+    lo = std::min(lo, t);
+    hi = std::max(hi, t);
+  }
+  const float inset = (hi - lo) / 32.f;
+  for (int c = 0; c < N; c++)
+  {
+    e0[c] = std::clamp(mean[c] + axis[c] * (lo + inset), 0.f, 255.f);
+    e1[c] = std::clamp(mean[c] + axis[c] * (hi - inset), 0.f, 255.f);
+  }
+}
+
+// endpoints minimizing the squared error for fixed indices, false when all pixels share one weight
+template<int N>
+static bool least_squares_endpoints(const Block &block, const float *weights, float e0[N], float e1[N])
+{
+  float aa = 0.f, bb = 0.f, ab = 0.f, ax[N] = {}, bx[N] = {};
+  for (int i = 0; i < 16; i++)
+  {
+    const float b = weights[i], a = 1.f - b;
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (int c = 0; c < N; c++)
+    {
+      ax[c] += a * block[i][c];
+      bx[c] += b * block[i][c];
+    }
+  }
+  const float det = aa * bb - ab * ab;
+  if (std::abs(det) < 1e-6f)
+    return false;
+  for (int c = 0; c < N; c++)
+  {
+    e0[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.f, 255.f);
+    e1[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.f, 255.f);
+  }
+  return true;
+}
+
+static uint16_t to_565(const float c[3])
+{
+  const int r = std::clamp((int)std::lround(c[0] * 31.f / 255.f), 0, 31);
+  const int g = std::clamp((int)std::lround(c[1] * 63.f / 255.f), 0, 63);
+  const int b = std::clamp((int)std::lround(c[2] * 31.f / 255.f), 0, 31);
+  return r << 11 | g << 5 | b;
+}
+
+static void from_565(uint16_t c, int rgb[3])
+{
+  rgb[0] = (c >> 11 & 31) * 255 / 31;
+  rgb[1] = (c >> 5 & 63) * 255 / 63;
+  rgb[2] = (c & 31) * 255 / 31;
+}
+
+struct ColorBlock
+{
+  uint16_t c0, c1;
+  uint32_t indices;
+  int error;
+};
+
+// always the 4 color mode (c0 > c1), which is also the only mode of the bc3 color block
+static ColorBlock encode_color(const Block &block, const float e0[3], const float e1[3])
+{
+  ColorBlock result{to_565(e0), to_565(e1), 0, 0};
+  if (result.c0 < result.c1)
+    std::swap(result.c0, result.c1);
+  if (result.c0 == result.c1)
+  {
+    // a single color, every index picks c0
+    int rgb[3];
+    from_565(result.c0, rgb);
+    for (int i = 0; i < 16; i++)
+      for (int c = 0; c < 3; c++)
+        result.error += (block[i][c] - rgb[c]) * (block[i][c] - rgb[c]);
+    return result;
+  }
+
+  int palette[4][3];
+  from_565(result.c0, palette[0]);
+  from_565(result.c1, palette[1]);
+  for (int c = 0; c < 3; c++)
+  {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  for (int i = 0; i < 16; i++)
+  {
+    int best = 0, bestError = INT32_MAX;
+    for (int p = 0; p < 4; p++)
+    {
+      int error = 0;
+      for (int c = 0; c < 3; c++)
+        error += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+      if (error < bestError)
+      {
+        bestError = error;
+        best = p;
+      }
+    }
+    result.indices |= (uint32_t)best << (i * 2);
+    result.error += bestError;
+  }
+  return result;
+}
+
+static void compress_color_block(const Block &block, uint8_t *out)
+{
+  float e0[3], e1[3];
+  fit_endpoints<3>(block, e0, e1);
+  ColorBlock best = encode_color(block, e0, e1);
+
+  // one refinement pass: refit endpoints to the chosen indices
+  static const float paletteWeights[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+  float weights[16];
+  for (int i = 0; i < 16; i++)
+    weights[i] = paletteWeights[best.indices >> (i * 2) & 3];
+  if (least_squares_endpoints<3>(block, weights, e0, e1))
+  {
+    ColorBlock refined = encode_color(block, e0, e1);
+    if (refined.error < best.error)
+      best = refined;
+  }
+
+  memcpy(out, &best.c0, 2);
+  memcpy(out + 2, &best.c1, 2);
+  memcpy(out + 4, &best.indices, 4);
+}
+
+static void compress_alpha_block(const Block &block, uint8_t *out)
+{
+  int lo = 255, hi = 0;
+  for (int i = 0; i < 16; i++)
+  {
+    lo = std::min<int>(lo, block[i][3]);
+    hi = std::max<int>(hi, block[i][3]);
+  }
+  // 8 alpha mode: a0 > a1, 6 interpolated values between them
+  out[0] = hi;
+  out[1] = lo;
+  uint64_t indices = 0;
+  if (hi > lo)
+  {
+    int palette[8] = {hi, lo};
+    for (int p = 2; p < 8; p++)
+      palette[p] = ((8 - p) * hi + (p - 1) * lo) / 7;
+    for (int i = 0; i < 16; i++)
+    {
+      int best = 0;
+      for (int p = 1; p < 8; p++)
+        if (std::abs(block[i][3] - palette[p]) < std::abs(block[i][3] - palette[best]))
+          best = p;
+      indices |= (uint64_t)best << (i * 3);
+    }
+  }
+  memcpy(out + 2, &indices, 6);
+}
+
+// bc7 mode 6: one subset, rgba endpoints of 7 bits plus a shared lsb (p-bit) each, 4 bit indices
+static const int Bc7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7Block
+{
+  uint8_t endpoints[2][4]; // 7 bit values
+  uint8_t pbits[2];
+  uint8_t indices[16];
+  int error;
+};
+
+static void quantize_bc7_endpoint(const float e[4], uint8_t q[4], uint8_t &pbit)
+{
+  int bestError = INT32_MAX;
+  for (int p = 0; p < 2; p++)
+  {
+    int error = 0;
+    uint8_t candidate[4];
+    for (int c = 0; c < 4; c++)
+    {
+      candidate[c] = std::clamp((int)std::lround((e[c] - p) / 2.f), 0, 127);
+      int d = (candidate[c] << 1 | p) - (int)std::lround(e[c]);
+      error += d * d;
+    }
+    if (error < bestError)
+    {
+      bestError = error;
+      pbit = p;
+      memcpy(q, candidate, 4);
+    }
+  }
+}
+
+static Bc7Block encode_bc7(const Block &block, const float e0[4], const float e1[4])
+{
+  Bc7Block result{};
+  quantize_bc7_endpoint(e0, result.endpoints[0], result.pbits[0]);
+  quantize_bc7_endpoint(e1, result.endpoints[1], result.pbits[1]);
+
+  int palette[16][4];
+  for (int c = 0; c < 4; c++)
+  {
+    const int a = result.endpoints[0][c] << 1 | result.pbits[0];
+    const int b = result.endpoints[1][c] << 1 | result.pbits[1];
+    for (int p = 0; p < 16; p++)
+      palette[p][c] = ((64 - Bc7Weights[p]) * a + Bc7Weights[p] * b + 32) >> 6;
+  }
+  for (int i = 0; i < 16; i++)
+  {
+    int best = 0, bestError = INT32_MAX;
+    for (int p = 0; p < 16; p++)
+    {
+      int error = 0;
+      for (int c = 0; c < 4; c++)
+        error += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+      if (error < bestError)
+      {
+        bestError = error;
+        best = p;
+      }
+    }
+    result.indices[i] = best;
+    result.error += bestError;
+  }
+  return result;
+}
+
+struct BitWriter
+{
+  uint8_t *out;
+  int position = 0;
+
+  void write(uint32_t value, int bits)
+  {
+    for (int i = 0; i < bits; i++, position++)
+      if (value >> i & 1)
+        out[position / 8] |= 1 << (position % 8);
+  }
+};
+
+static void compress_bc7_block(const Block &block, uint8_t *out)
+{
+  float e0[4], e1[4];
+  fit_endpoints<4>(block, e0, e1);
+  Bc7Block best = encode_bc7(block, e0, e1);
+
+  float weights[16];
+  for (int i = 0; i < 16; i++)
+    weights[i] = Bc7Weights[best.indices[i]] / 64.f;
+  if (least_squares_endpoints<4>(block, weights, e0, e1))
+  {
+    Bc7Block refined = encode_bc7(block, e0, e1);
+    if (refined.error < best.error)
+      best = refined;
+  }
+
+  // the msb of the first index is implied zero, swap endpoints to make it so
+  if (best.indices[0] & 8)
+  {
+    std::swap(best.endpoints[0], best.endpoints[1]);
+    std::swap(best.pbits[0], best.pbits[1]);
+    for (uint8_t &index : best.indices)
+      index = 15 - index;
+  }
+
+  memset(out, 0, 16);
+  BitWriter writer{out};
+  writer.write(1 << 6, 7);
+  for (int c = 0; c < 4; c++)
+  {
+    writer.write(best.endpoints[0][c], 7);
+    writer.write(best.endpoints[1][c], 7);
+  }
+  writer.write(best.pbits[0], 1);
+  writer.write(best.pbits[1], 1);
+  writer.write(best.indices[0], 3);
+  for (int i = 1; i < 16; i++)
+    writer.write(best.indices[i], 4);
+}
+
+std::vector<uint8_t> compress_texture_level(const TextureData &rgba, TextureFormat format)
+{
+  if (format == TextureFormat::RGBA8)
+    return rgba.pixels;
+
+  std::vector<uint8_t> result(texture_level_size(format, rgba.width, rgba.height));
+  const size_t blockSize = format == TextureFormat::BC1 ? 8 : 16;
+  uint8_t *out = result.data();
+  for (int by = 0; by < rgba.height; by += 4)
+  {
+    for (int bx = 0; bx < rgba.width; bx += 4, out += blockSize)
+    {
+      Block block;
+      for (int i = 0; i < 16; i++)
+      {
+        const int x = std::min(bx + i % 4, rgba.width - 1), y = std::min(by + i / 4, rgba.height - 1);
+        memcpy(block[i], rgba.pixels.data() + ((size_t)y * rgba.width + x) * 4, 4);
+      }
+      switch (format)
+      {
+        case TextureFormat::BC1: compress_color_block(block, out); break;
+        case TextureFormat::BC3: compress_alpha_block(block, out); compress_color_block(block, out + 8); break;
+        default: compress_bc7_block(block, out); break;
+      }
+    }
+  }
+  return result;
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "texture_import.h"
+
+// how texture data is stored on the gpu
+enum class TextureFormat : uint32_t
+{
+  RGBA8,
+  BC1, // rgb, 4 bits per pixel
+  BC3, // rgba, 8 bits per pixel
+  BC7, // rgba, 8 bits per pixel, better quality than bc1/bc3
+  Count
+};
+
+// what the cooker produces
+enum class TextureCompression : uint32_t
+{
+  None,
+  Auto, // bc1 for opaque textures, bc3 for textures with alpha
+  BC7,
+};
+
+uint64_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height);
+
+// converts to 4 channels and box filters down to 1x1, level 0 is the source
+std::vector<TextureData> generate_mips(const TextureData &texture);
+
+TextureFormat choose_texture_format(const TextureData &rgba, TextureCompression compression);
+
+// rgba level -> format, partial blocks at the edges repeat the last row and column
+std::vector<uint8_t> compress_texture_level(const TextureData &rgba, TextureFormat format);
@@ -0,0 +1,62 @@
+#include "texture_import.h"
+#include <cstring>
+#include <log.h>
+#include "cooked_texture.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+enum TextureImportFlag
+{
+  FlipVertically = 1 << 0,
+};
+
+const unsigned TextureImportFlags = FlipVertically;
+
+bool import_texture(const char *path, TextureData &texture)
+{
+  int w, h, ch;
+  // stbi flip flag is global state, flip by hand to stay thread safe
+  auto stbiData = stbi_load(path, &w, &h, &ch, 0);
+  if (!stbiData)
+  {
+    debug_error("can't load %s", path);
+    return false;
+  }
+  texture.width = w;
+  texture.height = h;
+  texture.channels = ch;
+  texture.pixels.resize((size_t)w * h * ch);
+  const size_t rowSize = (size_t)w * ch;
+  for (int y = 0; y < h; y++)
+    memcpy(texture.pixels.data() + y * rowSize, stbiData + (h - 1 - y) * rowSize, rowSize);
+  stbi_image_free(stbiData);
+  return true;
+}
+
+uint64_t texture_cook_settings(TextureCompression compression)
+{
+  return (uint64_t)compression << 32 | TextureImportFlags;
+}
+
+bool cook_texture(const char *path, TextureCompression compression)
+{
+  SourceStamp source;
+  TextureData texture;
+  if (!make_source_stamp(path, source) || !import_texture(path, texture))
+    return false;
+
+  std::vector<TextureData> mips = generate_mips(texture);
+  TextureFormat format = choose_texture_format(mips[0], compression);
+  std::vector<std::vector<uint8_t>> levels;
+  for (const TextureData &mip : mips)
+    levels.push_back(compress_texture_level(mip, format));
+
+  std::string cookedPath = cooked_texture_path(path);
+  if (!save_cooked_texture(cookedPath.c_str(), source, texture_cook_settings(compression), format,
+      texture.width, texture.height, levels))
+  {
+    debug_error("can't cook %s", cookedPath.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// decoded pixels, rows are already flipped to the bottom-up order GL expects
+struct TextureData
+{
+  int width = 0;
+  int height = 0;
+  int channels = 0;
+  std::vector<uint8_t> pixels;
+};
+
+extern const unsigned TextureImportFlags;
+
+enum class TextureCompression : uint32_t;
+
+// what a cooked texture depends on: import flags in the low half, compression in the high half
+uint64_t texture_cook_settings(TextureCompression compression);
+
+bool import_texture(const char *path, TextureData &texture);
+
+// imports the file, builds the mip chain, compresses it and writes <path>.tex next to it
+bool cook_texture(const char *path, TextureCompression compression);
@@ -0,0 +1,22 @@
+#include "texture_source.h"
+#include <log.h>
+
+bool read_texture(const char *path, TextureSource &source)
+{
+  std::string cookedPath = cooked_texture_path(path);
+  const uint64_t settings = texture_cook_settings(RuntimeTextureCompression);
+  if ((source.cooked = open_cooked_texture(cookedPath.c_str(), path, settings)))
+    return true;
+
+  debug_log("cooking %s", path);
+  if (cook_texture(path, RuntimeTextureCompression) &&
+      (source.cooked = open_cooked_texture(cookedPath.c_str(), path, settings)))
+    return true;
+
+  // mips are built here too, so the main thread only copies levels
+  TextureData image;
+  if (!import_texture(path, image))
+    return false;
+  source.decoded = generate_mips(image);
+  return true;
+}
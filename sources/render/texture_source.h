@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+#include "cooked_texture.h"
+
+// what textures missing from the cooker output are cooked with on first load
+constexpr TextureCompression RuntimeTextureCompression = TextureCompression::Auto;
+
+// cooked data when it's up to date, otherwise the decoded source as an rgba mip chain, level 0 first
+struct TextureSource
+{
+  CookedTexturePtr cooked;
+  std::vector<TextureData> decoded;
+};
+
+// file io, decoding and cooking only, safe on any thread
+bool read_texture(const char *path, TextureSource &source);
@@ -0,0 +1,158 @@
+#include "texture_streaming.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include "glad/glad.h"
+#include "texture_uploader.h"
+
+// a level that isn't needed any more is dropped after this many frames, unless the budget needs it sooner
+constexpr int DropDelayFrames = 120;
+// storage reallocations per frame, each one copies the resident levels on the gpu
+constexpr int MaxReallocationsPerFrame = 4;
+
+struct StreamedTexture
+{
+  std::weak_ptr<Texture2D> texture;
+  TextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  std::vector<std::span<const uint8_t>> levels;
+  std::shared_ptr<const void> owner;
+  int tailLevel;     // levels from here on are never dropped
+  int residentLevel; // finest level in storage
+  int wantedLevel;
+  float requestedPixels = 0.f;
+  int unusedFrames = 0;
+};
+
+static std::map<const Texture2D *, StreamedTexture> streamedTextures;
+static uint64_t streamingBudget = DefaultTextureStreamingBudget;
+
+static uint64_t level_size(const StreamedTexture &t, int level)
+{
+  return t.levels[level].size();
+}
+
+// bytes of levels [level, tailLevel)
+static uint64_t streamed_bytes(const StreamedTexture &t, int level)
+{
+  uint64_t bytes = 0;
+  for (int i = level; i < t.tailLevel; i++)
+    bytes += level_size(t, i);
+  return bytes;
+}
+
+void register_streamed_texture(const Texture2DPtr &texture, TextureFormat format, uint32_t width, uint32_t height,
+  std::vector<std::span<const uint8_t>> levels, int resident_level, std::shared_ptr<const void> owner)
+{
+  streamedTextures[texture.get()] = StreamedTexture{texture, format, width, height, std::move(levels), std::move(owner),
+    resident_level, resident_level, resident_level};
+}
+
+void request_texture_resolution(const Texture2D &texture, float screen_pixels)
+{
+  auto it = streamedTextures.find(&texture);
+  if (it != streamedTextures.end())
+    it->second.requestedPixels = std::max(it->second.requestedPixels, screen_pixels);
+}
+
+void set_texture_streaming_budget(uint64_t bytes)
+{
+  streamingBudget = bytes;
+}
+
+uint64_t get_streamed_texture_bytes()
+{
+  uint64_t bytes = 0;
+  for (const auto &[key, t] : streamedTextures)
+    bytes += streamed_bytes(t, t.residentLevel);
+  return bytes;
+}
+
+// new storage for levels [level..), the resident levels it shares with the old storage are copied over
+// and the missing finer ones are queued for upload
+static void reallocate(Texture2D &texture, const Texture2DPtr &owner, StreamedTexture &t, int level)
+{
+  const int levelCount = t.levels.size();
+  const uint32_t width = std::max(1u, t.width >> level), height = std::max(1u, t.height >> level);
+  GLuint object;
+  glGenTextures(1, &object);
+  glBindTexture(GL_TEXTURE_2D, object);
+  glTexStorage2D(GL_TEXTURE_2D, levelCount - level, gl_internal_format(t.format), width, height);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount - level > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  const int kept = std::max(level, t.residentLevel);
+  for (int i = kept; i < levelCount; i++)
+  {
+    const uint32_t w = std::max(1u, t.width >> i), h = std::max(1u, t.height >> i);
+    glCopyImageSubData(texture.textureObject, GL_TEXTURE_2D, i - t.residentLevel, 0, 0, 0,
+      object, GL_TEXTURE_2D, i - level, 0, 0, 0, w, h, 1);
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, kept - level);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glDeleteTextures(1, &texture.textureObject);
+  texture.textureObject = object;
+  t.residentLevel = level;
+  if (kept > level)
+    queue_texture_upload(owner, t.format, width, height,
+      std::vector<std::span<const uint8_t>>(t.levels.begin() + level, t.levels.end()), kept - level, t.owner);
+}
+
+void update_texture_streaming()
+{
+  // wanted level from last frame's requests, the finest level that still maps to at least a pixel
+  uint64_t wantedBytes = 0;
+  for (auto it = streamedTextures.begin(); it != streamedTextures.end();)
+  {
+    StreamedTexture &t = it->second;
+    if (t.texture.expired())
+    {
+      it = streamedTextures.erase(it);
+      continue;
+    }
+    t.wantedLevel = t.tailLevel;
+    if (t.requestedPixels > 0.f)
+    {
+      const float texels = std::max(t.width, t.height);
+      const int level = (int)std::floor(std::log2(std::max(texels / t.requestedPixels, 1.f)));
+      t.wantedLevel = std::min(level, t.tailLevel);
+    }
+    t.requestedPixels = 0.f;
+    wantedBytes += streamed_bytes(t, t.wantedLevel);
+    ++it;
+  }
+
+  // over budget: the texture whose finest wanted level costs most gives it up, until everything fits
+  while (wantedBytes > streamingBudget)
+  {
+    StreamedTexture *largest = nullptr;
+    for (auto &[key, t] : streamedTextures)
+      if (t.wantedLevel < t.tailLevel && (!largest || level_size(t, t.wantedLevel) > level_size(*largest, largest->wantedLevel)))
+        largest = &t;
+    if (!largest)
+      break;
+    wantedBytes -= level_size(*largest, largest->wantedLevel);
+    largest->wantedLevel++;
+  }
+  const bool overBudget = get_streamed_texture_bytes() > streamingBudget;
+
+  int reallocations = 0;
+  for (auto &[key, t] : streamedTextures)
+  {
+    t.unusedFrames = t.wantedLevel > t.residentLevel ? t.unusedFrames + 1 : 0;
+    if (reallocations >= MaxReallocationsPerFrame)
+      continue;
+    Texture2DPtr texture = t.texture.lock();
+    // storage can't change under an upload, the uploader addresses levels of the current storage
+    if (is_texture_uploading(*texture))
+      continue;
+    if (t.wantedLevel < t.residentLevel || (t.wantedLevel > t.residentLevel && (overBudget || t.unusedFrames > DropDelayFrames)))
+    {
+      reallocate(*texture, texture, t, t.wantedLevel);
+      t.unusedFrames = 0;
+      reallocations++;
+    }
+  }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <vector>
+#include "texture2d.h"
+#include "texture_compressor.h"
+
+constexpr uint64_t DefaultTextureStreamingBudget = 256ull << 20;
+
+// the texture keeps only levels [resident_level..) in its storage, the streamer moves resident_level
+// between 0 and resident_level as the texture is requested, levels data stays alive through owner
+void register_streamed_texture(const Texture2DPtr &texture, TextureFormat format, uint32_t width, uint32_t height,
+  std::vector<std::span<const uint8_t>> levels, int resident_level, std::shared_ptr<const void> owner);
+
+// the texture covers about screen_pixels pixels this frame, the largest request of a frame wins
+void request_texture_resolution(const Texture2D &texture, float screen_pixels);
+
+// bytes of streamed levels all textures may keep resident, the always resident tails aren't counted
+void set_texture_streaming_budget(uint64_t bytes);
+uint64_t get_streamed_texture_bytes();
+
+// called by the main loop once a frame, before the uploads, with the requests of the previous frame
+void update_texture_streaming();
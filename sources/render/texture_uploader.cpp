@@ -0,0 +1,154 @@
+#include "texture_uploader.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include "glad/glad.h"
+
+// a few frames worth of buffers, so the copy of one frame never waits on the gpu reading an older one
+constexpr int PixelBufferCount = 4;
+constexpr uint64_t PixelBufferSize = 4 << 20;
+constexpr uint64_t UploadBytesPerFrame = 8 << 20;
+
+unsigned gl_internal_format(TextureFormat format)
+{
+  switch (format)
+  {
+    case TextureFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case TextureFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case TextureFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    default: return GL_RGBA8;
+  }
+}
+
+// rows [y, y + height) of the level, data points at the client copy or at 0 in a bound pixel buffer
+static void upload_rows(TextureFormat format, int level, uint32_t y, uint32_t width, uint32_t height,
+  const void *data, uint64_t size)
+{
+  if (format == TextureFormat::RGBA8)
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+  else
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, y, width, height, gl_internal_format(format), size, data);
+}
+
+void upload_texture_level(unsigned texture_object, TextureFormat format, int level, uint32_t width, uint32_t height,
+  std::span<const uint8_t> data)
+{
+  glBindTexture(GL_TEXTURE_2D, texture_object);
+  upload_rows(format, level, 0, width, height, data.data(), data.size());
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+struct PendingUpload
+{
+  std::weak_ptr<Texture2D> texture;
+  TextureFormat format;
+  uint32_t width;
+  uint32_t height;
+  std::vector<std::span<const uint8_t>> levels;
+  int level;     // being uploaded, counts down to 0
+  uint32_t row;  // next row of the level
+  std::shared_ptr<const void> owner;
+};
+
+struct PixelBuffer
+{
+  GLuint buffer = 0;
+  GLsync fence = nullptr;
+};
+
+static std::deque<PendingUpload> pendingUploads;
+static PixelBuffer pixelBuffers[PixelBufferCount];
+static int nextPixelBuffer = 0;
+
+void queue_texture_upload(const Texture2DPtr &texture, TextureFormat format, uint32_t width, uint32_t height,
+  std::vector<std::span<const uint8_t>> levels, int first_level, std::shared_ptr<const void> owner)
+{
+  if (first_level <= 0)
+    return;
+  pendingUploads.push_back(PendingUpload{texture, format, width, height, std::move(levels), first_level - 1, 0, std::move(owner)});
+}
+
+bool is_texture_uploading(const Texture2D &texture)
+{
+  for (const PendingUpload &upload : pendingUploads)
+    if (upload.texture.lock().get() == &texture)
+      return true;
+  return false;
+}
+
+// the next buffer of the ring once the gpu is done with it, nullptr if it's still in flight
+static PixelBuffer *acquire_pixel_buffer()
+{
+  PixelBuffer &pixelBuffer = pixelBuffers[nextPixelBuffer];
+  if (!pixelBuffer.buffer)
+  {
+    glGenBuffers(1, &pixelBuffer.buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer.buffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, PixelBufferSize, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  if (pixelBuffer.fence)
+  {
+    if (glClientWaitSync(pixelBuffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      return nullptr;
+    glDeleteSync(pixelBuffer.fence);
+    pixelBuffer.fence = nullptr;
+  }
+  nextPixelBuffer = (nextPixelBuffer + 1) % PixelBufferCount;
+  return &pixelBuffer;
+}
+
+void process_texture_uploads()
+{
+  uint64_t budget = UploadBytesPerFrame;
+  while (!pendingUploads.empty() && budget > 0)
+  {
+    PendingUpload &upload = pendingUploads.front();
+    Texture2DPtr texture = upload.texture.lock();
+    if (!texture)
+    {
+      pendingUploads.pop_front();
+      continue;
+    }
+
+    // whole rows of blocks per chunk, as many as fit into one buffer
+    const uint32_t width = std::max(1u, upload.width >> upload.level), height = std::max(1u, upload.height >> upload.level);
+    const uint64_t blockRowSize = texture_level_size(upload.format, width, 4);
+    const uint32_t rows = std::min<uint64_t>(height - upload.row, std::max<uint64_t>(1, PixelBufferSize / blockRowSize) * 4);
+    const uint64_t offset = upload.row / 4 * blockRowSize;
+    const uint64_t size = texture_level_size(upload.format, width, rows);
+    const uint8_t *data = upload.levels[upload.level].data() + offset;
+
+    glBindTexture(GL_TEXTURE_2D, texture->textureObject);
+    if (size > PixelBufferSize)
+    {
+      // a single row of blocks doesn't fit, nothing to split
+      upload_rows(upload.format, upload.level, upload.row, width, rows, data, size);
+    }
+    else
+    {
+      PixelBuffer *pixelBuffer = acquire_pixel_buffer();
+      if (!pixelBuffer)
+        break;
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer->buffer);
+      void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+      memcpy(mapped, data, size);
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+      upload_rows(upload.format, upload.level, upload.row, width, rows, nullptr, size);
+      pixelBuffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    budget -= std::min(budget, size);
+
+    upload.row += rows;
+    if (upload.row >= height)
+    {
+      // the level is complete, let sampling use it
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.level);
+      upload.row = 0;
+      if (upload.level-- == 0)
+        pendingUploads.pop_front();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <memory>
+#include <span>
+#include <vector>
+#include "texture2d.h"
+#include "texture_compressor.h"
+
+unsigned gl_internal_format(TextureFormat format);
+
+// copies level data into a texture made with glTexStorage2D, from client memory, right now
+void upload_texture_level(unsigned texture_object, TextureFormat format, int level, uint32_t width, uint32_t height,
+  std::span<const uint8_t> data);
+
+// queues levels[0..first_level) for upload through the pixel buffer ring, the smallest of them goes first
+// first_level is the base level already resident, levels from it on are there and aren't touched
+// the texture's base level follows the uploads, so it samples the finest level that is complete
+// owner keeps level data alive until the uploads are done
+void queue_texture_upload(const Texture2DPtr &texture, TextureFormat format, uint32_t width, uint32_t height,
+  std::vector<std::span<const uint8_t>> levels, int first_level, std::shared_ptr<const void> owner);
+
+bool is_texture_uploading(const Texture2D &texture);
+
+// called by the main loop once a frame, uploads what fits into the frame budget and free pixel buffers
+void process_texture_uploads();
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <fnv.h>
+
+// uniform name hashed at compile time, shaders resolve it to a location once after linking,
+// so setting a uniform by id does no string work or driver lookup
+struct UniformId
+{
+  uint32_t hash;
+
+  bool operator==(const UniformId &other) const { return hash == other.hash; }
+};
+
+constexpr UniformId uniform_id(std::string_view name)
+{
+  return UniformId{fnv1a32(name)};
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <array>
+#include <cstring>
+#include <span>
+#include <vector>
+#include <3dmath.h>
+#include "glad/glad.h"
+
+// how a channel type is fed to the vertex shader
+template<typename T>
+struct VertexChannel;
+
+template<>
+struct VertexChannel<vec2>
+{
+  static constexpr int components = 2;
+  static constexpr GLenum type = GL_FLOAT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<vec3>
+{
+  static constexpr int components = 3;
+  static constexpr GLenum type = GL_FLOAT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<vec4>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_FLOAT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<uvec4>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_UNSIGNED_INT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = true;
+};
+
+// compact channel types, the shader still sees vec3/vec2/vec4/uvec4
+struct PackedNormal
+{
+  uint32_t xyzw; // snorm 10:10:10:2
+};
+
+struct HalfUV
+{
+  uint32_t xy; // two half floats
+};
+
+struct PackedWeights
+{
+  uint8_t w[4]; // unorm8, summing to 255
+};
+
+struct BoneIndex8
+{
+  uint8_t i[4];
+};
+
+struct BoneIndex16
+{
+  uint16_t i[4];
+};
+
+template<>
+struct VertexChannel<PackedNormal>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_INT_2_10_10_10_REV;
+  static constexpr bool normalized = true;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<HalfUV>
+{
+  static constexpr int components = 2;
+  static constexpr GLenum type = GL_HALF_FLOAT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<PackedWeights>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_UNSIGNED_BYTE;
+  static constexpr bool normalized = true;
+  static constexpr bool integer = false;
+};
+
+template<>
+struct VertexChannel<BoneIndex8>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_UNSIGNED_BYTE;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = true;
+};
+
+template<>
+struct VertexChannel<BoneIndex16>
+{
+  static constexpr int components = 4;
+  static constexpr GLenum type = GL_UNSIGNED_SHORT;
+  static constexpr bool normalized = false;
+  static constexpr bool integer = true;
+};
+
+// interleaved vertex, channel i goes to attribute location i
+template<typename... Channel>
+struct VertexFormat
+{
+  static constexpr int channelCount = sizeof...(Channel);
+  static constexpr size_t stride = (sizeof(Channel) + ... + 0);
+  static constexpr std::array<size_t, channelCount> offsets = []()
+  {
+    constexpr size_t sizes[] = {sizeof(Channel)...};
+    std::array<size_t, channelCount> result{};
+    size_t offset = 0;
+    for (int i = 0; i < channelCount; i++)
+    {
+      result[i] = offset;
+      offset += sizes[i];
+    }
+    return result;
+  }();
+  static_assert(((sizeof(Channel) % 4 == 0) && ...), "vertex attributes must be 4 byte aligned");
+};
+
+using StaticVertex = VertexFormat<vec3, vec3, vec2>;
+using SkinnedVertex = VertexFormat<vec3, vec3, vec2, vec4, uvec4>;
+using CompactSkinnedVertex8 = VertexFormat<vec3, PackedNormal, HalfUV, PackedWeights, BoneIndex8>;
+using CompactSkinnedVertex16 = VertexFormat<vec3, PackedNormal, HalfUV, PackedWeights, BoneIndex16>;
+
+enum class MeshVertexFormat : uint32_t
+{
+  Skinned,
+  CompactSkinned8,
+  CompactSkinned16,
+  Static,
+  Count
+};
+
+inline size_t vertex_stride(MeshVertexFormat format)
+{
+  switch (format)
+  {
+    case MeshVertexFormat::CompactSkinned8: return CompactSkinnedVertex8::stride;
+    case MeshVertexFormat::CompactSkinned16: return CompactSkinnedVertex16::stride;
+    case MeshVertexFormat::Static: return StaticVertex::stride;
+    default: return SkinnedVertex::stride;
+  }
+}
+
+template<typename T>
+void interleave_channel(uint8_t *dst, size_t stride, std::span<const T> channel)
+{
+  for (size_t i = 0; i < channel.size(); i++, dst += stride)
+    memcpy(dst, &channel[i], sizeof(T));
+}
+
+// empty channels stay zero, so a mesh without uv or bones still fits the format
+template<typename... Channel>
+std::vector<uint8_t> interleave_vertices(VertexFormat<Channel...>, size_t vertex_count, std::span<const Channel>... channels)
+{
+  using Format = VertexFormat<Channel...>;
+  std::vector<uint8_t> vertices(vertex_count * Format::stride, 0);
+  int i = 0;
+  (interleave_channel(vertices.data() + Format::offsets[i++], Format::stride, channels.first(std::min(channels.size(), vertex_count))), ...);
+  return vertices;
+}
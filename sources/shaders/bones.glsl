@@ -1,13 +1,6 @@
 #shader bones
 
-layout(std140, binding = 0) uniform GlobalRenderData
-{
-    mat4 ViewProjection;
-    vec3 CameraPosition;
-    vec3 LightDirection;
-    vec3 AmbientLight;
-    vec3 SunLight;
-};
+#include "global_render_data.glsl"
 
 struct VsOutput
 {
@@ -32,6 +25,7 @@ layout(location = 0)in vec3 Position;
 layout(location = 1)in vec3 Normal;
 
 out VsOutput vsOutput;
+flat out int instanceID;
 
 void main()
 {
@@ -50,24 +44,11 @@ void main()
 #pixel_shader
 
 in VsOutput vsOutput;
+flat in int instanceID;
 out vec4 FragColor;
 
-vec3 LightedColor(
-  vec3 color,
-  float shininess,
-  float metallness,
-  vec3 world_position,
-  vec3 world_normal,
-  vec3 light_dir,
-  vec3 camera_pos)
-{
-  vec3 W = normalize(camera_pos - world_position);
-  vec3 E = reflect(light_dir, world_normal);
-  float df = max(0.0, dot(world_normal, -light_dir));
-  float sf = max(0.0, dot(E, W));
-  sf = pow(sf, shininess);
-  return color * (AmbientLight + df * SunLight) + vec3(1,1,1) * sf * metallness;
-}
+#include "lighting.glsl"
+
 void main()
 {
   float shininess = 40;
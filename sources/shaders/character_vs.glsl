@@ -7,8 +7,17 @@ struct VsOutput
   vec2 UV;
 };
 
-uniform mat4 Transform;
-uniform mat4 ViewProjection;
+#include "global_render_data.glsl"
+
+struct Instance
+{
+  mat4 Transform;
+  uvec4 TextureLayers;
+};
+layout(std430, binding = 1) readonly buffer InstanceData
+{
+  Instance instances[];
+};
 
 
 layout(location = 0) in vec3 Position;
@@ -18,12 +27,16 @@ layout(location = 3) in vec4 BoneWeights;
 layout(location = 4) in uvec4 BoneIndex;
 
 out VsOutput vsOutput;
+flat out uint MainTexLayer;
 
 void main()
 {
+  mat4 Transform = instances[gl_InstanceID].Transform;
+  MainTexLayer = instances[gl_InstanceID].TextureLayers.x;
 
   vec3 VertexPosition = (Transform * vec4(Position, 1)).xyz;
-  vsOutput.EyespaceNormal = (Transform * vec4(Normal, 0)).xyz;
+  // normal may come from a 10:10:10:2 attribute, renormalize after unpacking
+  vsOutput.EyespaceNormal = (Transform * vec4(normalize(Normal), 0)).xyz;
 
   gl_Position = ViewProjection * vec4(VertexPosition, 1);
   vsOutput.WorldPosition = VertexPosition;
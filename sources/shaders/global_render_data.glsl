@@ -0,0 +1,11 @@
+#pragma once
+// frame constants, must match GlobalRenderData of render/global_render_data.h
+
+layout(std140, binding = 0) uniform GlobalRenderData
+{
+  mat4 ViewProjection;
+  vec3 CameraPosition;
+  vec3 LightDirection;
+  vec3 AmbientLight;
+  vec3 SunLight;
+};